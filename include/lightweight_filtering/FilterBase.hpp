@@ -10,63 +10,24 @@
 
 #include "lightweight_filtering/common.hpp"
 #include "lightweight_filtering/PropertyHandler.hpp"
+#include "lightweight_filtering/MeasurementTimeline.hpp"
+#include "lightweight_filtering/WorkerPool.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 namespace LWF{
 
-template<typename Meas>
-class MeasurementTimeline{
- public:
-  typedef Meas mtMeas;
-  std::map<double,mtMeas> measMap_;
-  typename std::map<double,mtMeas>::iterator itMeas_;
-  double maxWaitTime_;
-  double minWaitTime_;
-  MeasurementTimeline(){
-    maxWaitTime_ = 0.1;
-    minWaitTime_ = 0.0;
-  };
-  virtual ~MeasurementTimeline(){};
-  void addMeas(const mtMeas& meas, const double& t){
-    measMap_[t] = meas;
-  }
-  void clear()
-  {
-    measMap_.clear();
-  }
-  void clean(double t){
-    while(measMap_.size() > 1 && measMap_.begin()->first<=t){
-      measMap_.erase(measMap_.begin());
-    }
-  }
-  bool getNextTime(double actualTime, double& nextTime){
-    itMeas_ = measMap_.upper_bound(actualTime);
-    if(itMeas_!=measMap_.end()){
-      nextTime = itMeas_->first;
-      return true;
-    } else {
-      return false;
-    }
-  }
-  void waitTime(double actualTime, double& time){
-    double measurementTime = actualTime-maxWaitTime_;
-    if(!measMap_.empty() && measMap_.rbegin()->first + minWaitTime_ > measurementTime){
-      measurementTime = measMap_.rbegin()->first + minWaitTime_;
-    }
-    if(time > measurementTime){
-      time = measurementTime;
-    }
-  }
-  bool getLastTime(double& lastTime){
-    if(!measMap_.empty()){
-      lastTime = measMap_.rbegin()->first;
-      return true;
-    } else {
-      return false;
-    }
-  }
-  bool hasMeasurementAt(double t){
-    return measMap_.count(t)>0;
-  }
+template<typename... Updates>
+struct InnovationDimension{
+  static const int D_ = 0;
+};
+template<typename Update,typename... Updates>
+struct InnovationDimension<Update,Updates...>{
+  static const int D_ = Update::mtInnovation::D_ + InnovationDimension<Updates...>::D_;
 };
 
 template<typename Prediction,typename... Updates>
@@ -77,31 +38,141 @@ class FilterBase: public PropertyHandler{
   typedef typename mtPrediction::mtState mtState;
   static const unsigned int D_ = mtState::D_;
   static const int nUpdates_ = sizeof...(Updates);
+  static const int jointInnovationDim_ = InnovationDimension<Updates...>::D_; // Upper bound of the joint innovation dimension
   typedef typename mtPrediction::mtFilterState mtFilterState;
+  typedef typename mtFilterState::mtTime mtTime; // Time stamp type, see TimeTraits (durations and wait times are in seconds)
+  typedef TimeTraits<mtTime> mtTimeTraits;
   mtFilterState safe_;
   mtFilterState front_;
   mtFilterState init_;
-  MeasurementTimeline<typename mtPrediction::mtMeas> predictionTimeline_;
-  std::tuple<MeasurementTimeline<typename Updates::mtMeas>...> updateTimelineTuple_;
+  MeasurementTimeline<typename mtPrediction::mtMeas,mtTime> predictionTimeline_;
+  std::tuple<MeasurementTimeline<typename Updates::mtMeas,mtTime>...> updateTimelineTuple_;
   mtPrediction mPrediction_;
   typedef std::tuple<Updates...> mtUpdates;
   mtUpdates mUpdates_;
-  double safeWarningTime_;
-  double frontWarningTime_;
-  bool gotFrontWarning_;
+  std::atomic<mtTime> safeWarningTime_; // Atomic since they are read by sensor threads in pushPredictionMeas/pushUpdateMeas
+  std::atomic<mtTime> rollbackWarningTime_; // Time of the oldest checkpoint (safe time without checkpoints), late measurements after it can be rolled back
+  std::atomic<mtTime> frontWarningTime_;
+  std::atomic<bool> gotFrontWarning_;
+  bool safeUpToDate_; // No measurement was added since the last complete updateSafe, safe_ cannot advance (see invalidateWatermark)
+  mtTime safeWatermark_; // Cached result of getWatermark, only changes if a measurement extends a timeline
+  bool hasWatermark_;
+  bool watermarkValid_;
+  bool autoUpdateSafe_; // Run updateSafe from the add functions as soon as the watermark is minSafeBatchInterval_ ahead of safe_
+  double minSafeBatchInterval_;
+  bool safeUpdateActive_;
+  unsigned int autoUpdateCount_;
+  std::function<void(const mtFilterState&)> safeUpdateCallback_; // Called whenever updateSafe changed safe_ (from the background thread if it is running)
+  mtTime frontRequestTime_; // Time up to which front_ is computed on the next getFront
   bool updateToUpdateMeasOnly_;
   unsigned int logCountMerPre_;
   unsigned int logCountRegPre_;
   unsigned int logCountBadPre_;
   unsigned int logCountComUpd_;
   unsigned int logCountRegUpd_;
+  unsigned int logCountJoiUpd_;
   bool logCountDiagnostics_;
+  bool useJointUpdates_; // Fuse updates of different types sharing a timestamp into one stacked EKF update
+  Eigen::MatrixXd jointH_;
+  Eigen::MatrixXd jointPy_;
+  Eigen::MatrixXd jointPyx_;
+  Eigen::MatrixXd jointK_;
+  Eigen::MatrixXd jointPyinv_;
+  Eigen::LLT<Eigen::MatrixXd> jointPyLLT_;
+  Eigen::VectorXd jointInnVector_;
+  typename mtState::mtDifVec jointUpdateVec_;
+  bool jointActive_[nUpdates_ > 0 ? nUpdates_ : 1];
+  int jointOffset_[nUpdates_ > 0 ? nUpdates_ : 1]; // Row of the active update types within the joint system
+  int jointInnovationDimActive_;
+  typedef uint64_t mtEventMask; // Bit i is set if update type i has a measurement at the corresponding time
+  static_assert(nUpdates_ <= 64, "The event index supports at most 64 update types");
+  /*!
+   * Merged index over all update timelines, maintained by addUpdateMeas and clean. update() only visits update
+   * measurements listed here: measurements added directly through a timeline's addMeas are not found by update().
+   */
+  TimeRingBuffer<mtEventMask,mtTime> eventIndex_;
+  mtEventMask eventMask_; // Update types with a measurement at the current step of update()
+  bool useAsyncPreProcessing_; // Run Update::preProcessMeas on worker threads as soon as a measurement is added
+  int numPreProcessingThreads_; // Negative values are treated as 0 (preprocessing runs inline)
+  std::shared_ptr<const mtFilterState> preProcessingPrior_; // Copy of front_ shared by the preprocessing tasks of one time step
+  bool useRollback_; // Keep checkpoints of the safe branch and roll back to them for measurements older than the safe time
+  double rollbackHorizon_; // Time span covered by the checkpoints [s]
+  int maxNumCheckpoints_;
+  std::deque<mtFilterState,Eigen::aligned_allocator<mtFilterState>> checkpoints_; // Copies of safe_ after each updateSafe, ordered by time
+  bool rollbackPending_;
+  mtTime rollbackTime_; // Time of the oldest late measurement since the last updateSafe
+  unsigned int rollbackCount_;
+  /*!
+   * Compact history of the safe branch for queryState: the mean and selected marginal covariance blocks after each step.
+   */
+  struct StateHistoryEntry{
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    mtTime t_;
+    mtState state_;
+    Eigen::VectorXd covBlocks_; // Blocks of stateHistoryCovBlocks_, column-major one after another
+  };
+  bool useStateHistory_;
+  int stateHistorySize_; // Maximal number of entries, the oldest are dropped
+  std::vector<std::pair<int,int>> stateHistoryCovBlocks_; // Diagonal blocks (start index, size) of the covariance stored in the history
+  std::deque<StateHistoryEntry,Eigen::aligned_allocator<StateHistoryEntry>> stateHistory_;
+  /*!
+   * Latency governor: if an updateFront call exceeds frontBudget_ the degradation level is raised by one, after
+   * recoveryCount_ consecutive calls below recoveryFraction_*frontBudget_ it is lowered by one. The levels are cumulative:
+   * 1: merged predictions (skipped if the prediction cannot merge, see canMerge_), 2: IEKF iterations capped to
+   * degradedMaxNumIteration_, 3: EKF for all models (no adaptive escalation of the updates), 4: update types with less than the highest updatePriority_ are skipped.
+   * Levels above maxDegradationLevel_ are not used.
+   */
+  double frontBudget_; // [s], 0 disables the governor
+  int maxDegradationLevel_;
+  int degradedMaxNumIteration_;
+  double recoveryFraction_;
+  int recoveryCount_;
+  int updatePriority_[nUpdates_ > 0 ? nUpdates_ : 1];
+  int degradationLevel_;
+  int withinBudgetCount_;
+  double lastFrontDuration_;
+  unsigned int overBudgetCount_;
+  unsigned int degradationChangeCount_;
+  mtEventMask skippedUpdates_; // Masked out of the event index at degradation level 4
+  struct ModelSettings{
+    int maxNumIteration_;
+    bool useIndividualMode_;
+    bool useAdaptiveMode_;
+    FilteringMode mode_;
+  };
+  ModelSettings savedUpdateSettings_[nUpdates_ > 0 ? nUpdates_ : 1]; // Nominal settings, restored when the level drops
+  ModelSettings savedPredictionSettings_;
+  /*!
+   * Two-thread operation (startSafeThread): a background thread runs updateSafe and publishes safe_ into a double
+   * buffer, the caller's thread serves asyncFront_ by predicting from the latest published snapshot (predictFront) with
+   * its own copy of the prediction model and its own prediction timeline. While the thread is running only
+   * pushPredictionMeas, pushUpdateMeas, predictFront, extrapolate and predictHorizon may be used: all other members,
+   * including the const ones (queryState, memoryFootprint, ...), access state which the thread modifies. queryState
+   * returns false in this case, extrapolate and predictHorizon start from asyncFront_. safeUpdateCallback_ is then
+   * called from the background thread.
+   */
+  double safeThreadPeriod_; // [s], maximal time between two updateSafe calls of the background thread
+  std::atomic<bool> safeThreadRunning_;
+  std::atomic<bool> safeThreadWakeup_;
+  std::thread safeThread_;
+  std::mutex safeThreadMutex_;
+  std::condition_variable safeThreadCondition_;
+  mtFilterState publishedSafe_[2]; // Written by the background thread, publishedSafe_[publishedIndex_] is the readable one
+  int publishedIndex_;
+  std::atomic<unsigned int> publishedVersion_;
+  std::mutex publishMutex_; // Only held for switching and reading the published snapshot
+  mtFilterState asyncFront_;
+  unsigned int asyncFrontVersion_;
+  mtPrediction frontPrediction_; // Copy of mPrediction_ taken by startSafeThread (its property handler refers to mPrediction_)
+  MeasurementTimeline<typename mtPrediction::mtMeas,mtTime> frontPredictionTimeline_;
+  unsigned int frontCountPre_[3];
+  mtFilterState horizonState_; // Preallocated start and end state of predictHorizon
+  std::vector<mtState,Eigen::aligned_allocator<mtState>> horizonStates_;
+  Eigen::MatrixXd horizonCovs_;
+  WorkerPool preProcessingPool_; // Declared last such that pending tasks are finished before other members are destroyed
   FilterBase(){
     init_.state_.setIdentity();
     init_.cov_.setIdentity();
-    mPrediction_.doubleRegister_.registerScalar("alpha",init_.alpha_);
-    mPrediction_.doubleRegister_.registerScalar("beta",init_.beta_);
-    mPrediction_.doubleRegister_.registerScalar("kappa",init_.kappa_);
     init_.state_.registerElementsToPropertyHandler(this,"Init.State.");
     init_.state_.registerCovarianceToPropertyHandler_(init_.cov_,this,"Init.Covariance.");
     registerSubHandler("Prediction",mPrediction_);
@@ -109,92 +180,489 @@ class FilterBase: public PropertyHandler{
     reset();
     logCountDiagnostics_ = false;
     updateToUpdateMeasOnly_ = false;
+    useJointUpdates_ = false;
+    eventMask_ = 0;
+    boolRegister_.registerScalar("useJointUpdates",useJointUpdates_);
+    useAsyncPreProcessing_ = false;
+    numPreProcessingThreads_ = 1;
+    boolRegister_.registerScalar("useAsyncPreProcessing",useAsyncPreProcessing_);
+    intRegister_.registerScalar("numPreProcessingThreads",numPreProcessingThreads_);
+    useRollback_ = false;
+    rollbackHorizon_ = 1.0;
+    maxNumCheckpoints_ = 100;
+    rollbackCount_ = 0;
+    boolRegister_.registerScalar("useRollback",useRollback_);
+    doubleRegister_.registerScalar("rollbackHorizon",rollbackHorizon_);
+    intRegister_.registerScalar("maxNumCheckpoints",maxNumCheckpoints_);
+    useStateHistory_ = false;
+    stateHistorySize_ = 1000;
+    boolRegister_.registerScalar("useStateHistory",useStateHistory_);
+    intRegister_.registerScalar("stateHistorySize",stateHistorySize_);
+    watermarkValid_ = false;
+    hasWatermark_ = false;
+    safeWatermark_ = 0;
+    autoUpdateSafe_ = false;
+    minSafeBatchInterval_ = 0.0;
+    safeUpdateActive_ = false;
+    autoUpdateCount_ = 0;
+    boolRegister_.registerScalar("autoUpdateSafe",autoUpdateSafe_);
+    doubleRegister_.registerScalar("minSafeBatchInterval",minSafeBatchInterval_);
+    frontBudget_ = 0.0;
+    maxDegradationLevel_ = 4;
+    degradedMaxNumIteration_ = 2;
+    recoveryFraction_ = 0.5;
+    recoveryCount_ = 10;
+    degradationLevel_ = 0;
+    withinBudgetCount_ = 0;
+    lastFrontDuration_ = 0.0;
+    overBudgetCount_ = 0;
+    degradationChangeCount_ = 0;
+    skippedUpdates_ = 0;
+    doubleRegister_.registerScalar("frontBudget",frontBudget_);
+    intRegister_.registerScalar("maxDegradationLevel",maxDegradationLevel_);
+    intRegister_.registerScalar("degradedMaxNumIteration",degradedMaxNumIteration_);
+    doubleRegister_.registerScalar("recoveryFraction",recoveryFraction_);
+    intRegister_.registerScalar("recoveryCount",recoveryCount_);
+    safeThreadPeriod_ = 0.01;
+    safeThreadRunning_ = false;
+    safeThreadWakeup_ = false;
+    publishedIndex_ = 0;
+    publishedVersion_ = 0;
+    asyncFrontVersion_ = 0;
+    frontCountPre_[0] = frontCountPre_[1] = frontCountPre_[2] = 0;
+    doubleRegister_.registerScalar("safeThreadPeriod",safeThreadPeriod_);
   };
   virtual ~FilterBase(){
+    stopSafeThread();
   };
-  void reset(double t = 0.0){
+  void reset(mtTime t = 0){
     init_.t_ = t;
     init_.state_.fix();
     safe_ = init_;
     front_ = init_;
     safeWarningTime_ = t;
+    rollbackWarningTime_ = t;
     frontWarningTime_ = t;
     gotFrontWarning_ = false;
+    safeUpToDate_ = false;
+    frontRequestTime_ = t;
+    checkpoints_.clear();
+    rollbackPending_ = false;
+    rollbackTime_ = t;
+    stateHistory_.clear();
+    preProcessingPrior_.reset();
   }
   template<int i=0, typename std::enable_if<(i<nUpdates_)>::type* = nullptr>
   void registerUpdates(){
     registerSubHandler("Update" + std::to_string(i),std::get<i>(mUpdates_));
+    updatePriority_[i] = 0;
+    std::get<i>(mUpdates_).intRegister_.registerScalar("priority",updatePriority_[i]);
     std::get<i>(mUpdates_).outlierDetection_.registerToPropertyHandler(&std::get<i>(mUpdates_),"MahalanobisTh");
     registerUpdates<i+1>();
   }
   template<int i=0, typename std::enable_if<(i>=nUpdates_)>::type* = nullptr>
   void registerUpdates(){
   }
-  bool addPredictionMeas(const typename Prediction::mtMeas& meas, double t){
+  bool addPredictionMeas(const typename Prediction::mtMeas& meas, mtTime t){
+    return addPredictionMeas(predictionTimeline_.makeMeasPtr(meas),t);
+  }
+  bool addPredictionMeas(typename Prediction::mtMeas&& meas, mtTime t){
+    return addPredictionMeas(predictionTimeline_.makeMeasPtr(std::move(meas)),t);
+  }
+  bool addPredictionMeas(const std::shared_ptr<typename Prediction::mtMeas>& meas, mtTime t){
     bool measurement_too_late = false;
-    if(t<= safeWarningTime_) {
-      std::cout << "[FilterBase::addPredictionMeas] Warning: included measurements at time " << t << " before safeTime " << safeWarningTime_ << std::endl;
+    if(t<= safeWarningTime_ && !scheduleRollback(t)) {
+      std::cout << "[FilterBase::addPredictionMeas] Warning: included measurements at time " << t << " before safeTime " << safeWarningTime_.load() << std::endl;
       measurement_too_late = true;
     }
     if(t<= frontWarningTime_) gotFrontWarning_ = true;
-    predictionTimeline_.addMeas(meas,t);
+    safeUpToDate_ = false;
+    mtTime lastTime;
+    const bool extendsTimeline = !predictionTimeline_.getLastTime(lastTime) || t > lastTime;
+    if(!predictionTimeline_.addMeas(meas,t)) return false;
+    if(extendsTimeline) advanceWatermark();
     return !measurement_too_late;
   }
   template<int i>
-  bool addUpdateMeas(const typename std::tuple_element<i,decltype(mUpdates_)>::type::mtMeas& meas, double t){
+  bool addUpdateMeas(const typename std::tuple_element<i,decltype(mUpdates_)>::type::mtMeas& meas, mtTime t){
+    return addUpdateMeas<i>(std::get<i>(updateTimelineTuple_).makeMeasPtr(meas),t);
+  }
+  template<int i>
+  bool addUpdateMeas(typename std::tuple_element<i,decltype(mUpdates_)>::type::mtMeas&& meas, mtTime t){
+    return addUpdateMeas<i>(std::get<i>(updateTimelineTuple_).makeMeasPtr(std::move(meas)),t);
+  }
+  template<int i>
+  bool addUpdateMeas(const std::shared_ptr<typename std::tuple_element<i,decltype(mUpdates_)>::type::mtMeas>& meas, mtTime t){
     bool measurement_too_late = false;
-    if(t<= safeWarningTime_) {
-      std::cout << "[FilterBase::addUpdateMeas] Warning: included measurements at time " << t << " before safeTime " << safeWarningTime_ << std::endl;
+    if(t<= safeWarningTime_ && !scheduleRollback(t)) {
+      std::cout << "[FilterBase::addUpdateMeas] Warning: included measurements at time " << t << " before safeTime " << safeWarningTime_.load() << std::endl;
       measurement_too_late = true;
     }
     if(t<= frontWarningTime_) gotFrontWarning_ = true;
-    std::get<i>(updateTimelineTuple_).addMeas(meas,t);
+    safeUpToDate_ = false;
+    mtTime lastTime;
+    const bool extendsTimeline = !std::get<i>(updateTimelineTuple_).getLastTime(lastTime) || t > lastTime;
+    if(!std::get<i>(updateTimelineTuple_).addMeas(meas,t)) return false;
+    eventIndex_[t] |= mtEventMask(1) << i; // Might outlive the measurement if it is dropped due to the capacity limit
+    if(useAsyncPreProcessing_) launchPreProcessing<i>(t);
+    if(extendsTimeline) advanceWatermark();
     return !measurement_too_late;
   }
-  bool getSafeTime(double& safeTime){
-    double maxPredictionTime;
-    if(!predictionTimeline_.getLastTime(maxPredictionTime)){
-      safeTime = safe_.t_;
+  /*!
+   * Thread-safe counterparts of addPredictionMeas and addUpdateMeas for sensor threads. The measurements are put into the
+   * lock-free input queue of the timeline and are moved into the timeline by the filter thread at the beginning of
+   * updateSafe (drainInputQueues). Returns false if the measurement is too late (older than the safe time and, with
+   * useRollback_, not after the oldest checkpoint as of the push) or a queue is full, including the front prediction
+   * queue of the safe thread. The queue capacity of each timeline can be set with inputQueue_.setCapacity before
+   * measurements are pushed, the front prediction queue of the safe thread uses the capacity of predictionTimeline_. As for addPredictionMeas/addUpdateMeas, rvalues are
+   * moved into the queue and shared pointers are enqueued without copying the measurement.
+   */
+  bool pushPredictionMeas(const typename Prediction::mtMeas& meas, mtTime t){
+    return pushPredictionMeas(predictionTimeline_.makeMeasPtr(meas),t);
+  }
+  bool pushPredictionMeas(typename Prediction::mtMeas&& meas, mtTime t){
+    return pushPredictionMeas(predictionTimeline_.makeMeasPtr(std::move(meas)),t);
+  }
+  bool pushPredictionMeas(const std::shared_ptr<typename Prediction::mtMeas>& meas, mtTime t){
+    const bool accepted = pushMeas(predictionTimeline_,std::shared_ptr<typename Prediction::mtMeas>(meas),t);
+    std::atomic_thread_fence(std::memory_order_seq_cst); // Pairs with startSafeThread, the flag is read after the safe push
+    if(safeThreadRunning_ && !frontPredictionTimeline_.inputQueue_.push(std::make_pair(t,meas))){
+      std::cout << "[FilterBase::pushPredictionMeas] Warning: front input queue full, dropping measurement at time " << t << std::endl;
       return false;
     }
-    safeTime = maxPredictionTime;
-    // Check if we have to wait for update measurements
-    checkUpdateWaitTime(maxPredictionTime,safeTime);
-    if(safeTime <= safe_.t_){
+    return accepted;
+  }
+  template<int i>
+  bool pushUpdateMeas(const typename std::tuple_element<i,decltype(mUpdates_)>::type::mtMeas& meas, mtTime t){
+    return pushMeas(std::get<i>(updateTimelineTuple_),std::get<i>(updateTimelineTuple_).makeMeasPtr(meas),t);
+  }
+  template<int i>
+  bool pushUpdateMeas(typename std::tuple_element<i,decltype(mUpdates_)>::type::mtMeas&& meas, mtTime t){
+    return pushMeas(std::get<i>(updateTimelineTuple_),std::get<i>(updateTimelineTuple_).makeMeasPtr(std::move(meas)),t);
+  }
+  template<int i>
+  bool pushUpdateMeas(const std::shared_ptr<typename std::tuple_element<i,decltype(mUpdates_)>::type::mtMeas>& meas, mtTime t){
+    return pushMeas(std::get<i>(updateTimelineTuple_),std::shared_ptr<typename std::tuple_element<i,decltype(mUpdates_)>::type::mtMeas>(meas),t);
+  }
+  template<typename Timeline>
+  bool pushMeas(Timeline& timeline, typename Timeline::mtMeasPtr&& meas, mtTime t){
+    if(!timeline.inputQueue_.push(std::make_pair(t,std::move(meas)))){
+      std::cout << "[FilterBase::pushMeas] Warning: input queue full, dropping measurement at time " << t << std::endl;
+      return false;
+    }
+    if(safeThreadRunning_){
+      safeThreadWakeup_ = true;
+      safeThreadCondition_.notify_one();
+    }
+    return t > safeWarningTime_.load() || (useRollback_ && t > rollbackWarningTime_.load()); // As scheduleRollback on draining
+  }
+  void drainInputQueues(){
+    std::pair<mtTime,typename MeasurementTimeline<typename Prediction::mtMeas,mtTime>::mtMeasPtr> entry;
+    while(predictionTimeline_.inputQueue_.pop(entry)){
+      addPredictionMeas(entry.second,entry.first);
+    }
+    drainUpdateInputQueues();
+  }
+  template<int i=0, typename std::enable_if<(i<nUpdates_)>::type* = nullptr>
+  void drainUpdateInputQueues(){
+    typedef typename std::tuple_element<i,mtUpdates>::type mtUpdate;
+    std::pair<mtTime,typename MeasurementTimeline<typename mtUpdate::mtMeas,mtTime>::mtMeasPtr> entry;
+    while(std::get<i>(updateTimelineTuple_).inputQueue_.pop(entry)){
+      addUpdateMeas<i>(entry.second,entry.first);
+    }
+    drainUpdateInputQueues<i+1>();
+  }
+  template<int i=0, typename std::enable_if<(i>=nUpdates_)>::type* = nullptr>
+  void drainUpdateInputQueues(){
+  }
+  /*!
+   * Starts the state-independent preprocessing (Update::preProcessMeas) of the measurement at time t on the worker pool.
+   * A copy of front_ is passed as prior, it is shared by all measurements added while front_ remains at the same time.
+   * The filter waits for the result before the measurement is used.
+   */
+  template<int i>
+  void launchPreProcessing(mtTime t){
+    typedef typename std::tuple_element<i,mtUpdates>::type mtUpdate;
+    if(numPreProcessingThreads_ < 0){
+      std::cout << "Warning: numPreProcessingThreads_ is negative, preprocessing runs inline" << std::endl;
+      numPreProcessingThreads_ = 0;
+    }
+    preProcessingPool_.setNumThreads(numPreProcessingThreads_);
+    const mtUpdate* update = &std::get<i>(mUpdates_);
+    typename mtUpdate::mtMeas* meas = std::get<i>(updateTimelineTuple_).findMeas(t); // Erasing or replacing it waits for the task
+    if(meas == nullptr) return;
+    if(!preProcessingPrior_ || preProcessingPrior_->t_ != front_.t_){
+      std::shared_ptr<mtFilterState> prior(new mtFilterState());
+      *prior = front_;
+      preProcessingPrior_ = prior;
+    }
+    std::shared_ptr<const mtFilterState> prior = preProcessingPrior_;
+    std::get<i>(updateTimelineTuple_).addPending(t,preProcessingPool_.enqueue([update,meas,prior](){
+      update->preProcessMeas(*meas,*prior);
+    }));
+  }
+  /*!
+   * Marks a measurement older than the safe time for inclusion on the next updateSafe, which restores the latest
+   * checkpoint before t and re-runs the safe branch from there. Returns false if no such checkpoint is available.
+   */
+  bool scheduleRollback(mtTime t){
+    if(!useRollback_ || checkpoints_.empty() || checkpoints_.front().t_ >= t) return false;
+    if(!rollbackPending_ || t < rollbackTime_) rollbackTime_ = t;
+    rollbackPending_ = true;
+    return true;
+  }
+  void rollback(){
+    rollbackPending_ = false;
+    while(checkpoints_.size() > 1 && checkpoints_.back().t_ >= rollbackTime_){
+      checkpoints_.pop_back();
+    }
+    safe_ = checkpoints_.back();
+    while(!stateHistory_.empty() && stateHistory_.back().t_ > safe_.t_){
+      stateHistory_.pop_back();
+    }
+    safeWarningTime_ = safe_.t_;
+    gotFrontWarning_ = true;
+    safeUpToDate_ = false;
+    rollbackCount_++;
+  }
+  void addCheckpoint(){
+    if(checkpoints_.empty() || checkpoints_.back().t_ < safe_.t_){
+      checkpoints_.push_back(safe_);
+    }
+    while(checkpoints_.size() > 1 && ((int)checkpoints_.size() > maxNumCheckpoints_ || checkpoints_[1].t_ <= safe_.t_-mtTimeTraits::fromSeconds(rollbackHorizon_))){
+      checkpoints_.pop_front();
+    }
+    rollbackWarningTime_ = checkpoints_.front().t_;
+  }
+  void recordState(const mtFilterState& filterState){
+    if(stateHistory_.empty() || stateHistory_.back().t_ < filterState.t_){
+      stateHistory_.emplace_back();
+    }
+    StateHistoryEntry& entry = stateHistory_.back();
+    entry.t_ = filterState.t_;
+    entry.state_ = filterState.state_;
+    int size = 0;
+    for(const std::pair<int,int>& block : stateHistoryCovBlocks_) size += block.second*block.second;
+    entry.covBlocks_.resize(size);
+    int offset = 0;
+    for(const std::pair<int,int>& block : stateHistoryCovBlocks_){
+      Eigen::Map<Eigen::MatrixXd>(entry.covBlocks_.data()+offset,block.second,block.second) = filterState.cov_.block(block.first,block.first,block.second,block.second);
+      offset += block.second*block.second;
+    }
+    while((int)stateHistory_.size() > std::max(stateHistorySize_,1)){
+      stateHistory_.pop_front();
+    }
+  }
+  /*!
+   * Estimate of the safe branch at a past time t, interpolated on the manifold (boxMinus/boxPlus) between the neighbouring
+   * history entries. If cov is given it is set to the linearly interpolated stateHistoryCovBlocks_ and zero elsewhere.
+   * Returns false if t is not covered by the history. Does not modify the filter.
+   */
+  bool queryState(mtTime t, mtState& state, Eigen::MatrixXd* cov = nullptr) const{
+    if(safeThreadRunning_) return false;
+    if(stateHistory_.empty() || t < stateHistory_.front().t_ || t > stateHistory_.back().t_) return false;
+    auto it = std::lower_bound(stateHistory_.begin(),stateHistory_.end(),t,[](const StateHistoryEntry& entry, mtTime t){
+      return entry.t_ < t;
+    });
+    const StateHistoryEntry& next = *it;
+    const StateHistoryEntry& prev = it == stateHistory_.begin() ? next : *std::prev(it);
+    const double a = next.t_ > prev.t_ ? mtTimeTraits::toSeconds(t-prev.t_)/mtTimeTraits::toSeconds(next.t_-prev.t_) : 1.0;
+    typename mtState::mtDifVec dif;
+    next.state_.boxMinus(prev.state_,dif);
+    prev.state_.boxPlus(a*dif,state);
+    if(cov != nullptr){
+      cov->setZero(D_,D_);
+      const bool sameLayout = prev.covBlocks_.size() == next.covBlocks_.size();
+      int offset = 0;
+      for(const std::pair<int,int>& block : stateHistoryCovBlocks_){
+        const int s = block.second;
+        if(offset+s*s > next.covBlocks_.size()) break;
+        Eigen::Map<const Eigen::MatrixXd> covNext(next.covBlocks_.data()+offset,s,s);
+        if(sameLayout){
+          Eigen::Map<const Eigen::MatrixXd> covPrev(prev.covBlocks_.data()+offset,s,s);
+          cov->block(block.first,block.first,s,s) = (1.0-a)*covPrev + a*covNext;
+        } else {
+          cov->block(block.first,block.first,s,s) = covNext;
+        }
+        offset += s*s;
+      }
+    }
+    return true;
+  }
+  /*!
+   * Newest estimate which is not newer than t: front_ if it is valid, safe_ otherwise.
+   */
+  const mtFilterState& getNewestState(mtTime t) const{
+    return !gotFrontWarning_ && front_.t_ > safe_.t_ && front_.t_ <= t ? front_ : safe_;
+  }
+  /*!
+   * Mean-only extrapolation of the newest estimate (front_ if it is valid, safe_ otherwise) to t over the buffered prediction
+   * measurements, beyond the newest one the measurement is filled by Prediction::noMeasCaseMean. If cov is given it is set
+   * to the covariance of the start state, which is not propagated. Only the mean and the time of the start state are
+   * copied, so it costs O(D) per prediction measurement instead of the O(D^3) covariance propagation of updateFront. In
+   * two-thread operation it starts from asyncFront_ as left by the last predictFront (or predictHorizon) and uses the
+   * front prediction model and timeline, it must then be called from the same thread. Not const and not thread-safe:
+   * the evaluation binds the measurements to the prediction model (see Prediction::predictMean). Returns false if t is
+   * older than the start state.
+   */
+  bool extrapolate(mtTime t, mtState& state, Eigen::MatrixXd* cov = nullptr){
+    const bool useAsyncFront = safeThreadRunning_;
+    const mtFilterState& start = useAsyncFront ? asyncFront_ : getNewestState(t);
+    mtPrediction& prediction = useAsyncFront ? frontPrediction_ : mPrediction_;
+    const typename MeasurementTimeline<typename mtPrediction::mtMeas,mtTime>::mtMeasMap& measMap = useAsyncFront ? frontPredictionTimeline_.measMap_ : predictionTimeline_.measMap_;
+    if(t < start.t_) return false;
+    state = start.state_;
+    mtTime tState = start.t_;
+    for(auto it = measMap.upper_bound(tState);tState < t && it != measMap.end();it++){
+      const mtTime tNext = std::min(it->first,t);
+      prediction.predictMean(state,*it->second,mtTimeTraits::toSeconds(tNext-tState));
+      tState = tNext;
+    }
+    if(tState < t){
+      const double dt = mtTimeTraits::toSeconds(t-tState);
+      typename mtPrediction::mtMeas meas;
+      meas.setIdentity();
+      prediction.noMeasCaseMean(state,meas,dt);
+      prediction.predictMean(state,meas,dt);
+    }
+    if(cov != nullptr){
+      *cov = start.cov_;
+    }
+    return true;
+  }
+  /*!
+   * Batched prediction of the newest estimate to the increasing times[0..n-1] in a single pass (see
+   * Prediction::predictHorizon), e.g. for model-predictive control. The results are stored in horizonStates_ and
+   * horizonCovs_ (D x n*D, covariance k in the columns k*D to (k+1)*D-1), which are reused between calls. Returns false
+   * if times[0] is older than safe_ (asyncFront_ in two-thread operation). Does not modify the filter estimate: the
+   * prediction model (frontPrediction_ in two-thread operation) runs on its horizonWorkspace_ and on horizonState_, into
+   * which only the time, mean, covariance and mode of the start state are copied.
+   */
+  bool predictHorizon(const mtTime* times, int n, bool reuseJacobians = false){
+    if(n <= 0) return true;
+    const mtFilterState* start;
+    mtPrediction* prediction;
+    const MeasurementTimeline<typename mtPrediction::mtMeas,mtTime>* timeline;
+    if(safeThreadRunning_){
+      refreshFront();
+      start = &asyncFront_;
+      prediction = &frontPrediction_;
+      timeline = &frontPredictionTimeline_;
+    } else {
+      start = &getNewestState(times[0]);
+      prediction = &mPrediction_;
+      timeline = &predictionTimeline_;
+    }
+    if(times[0] < start->t_) return false;
+    horizonState_.t_ = start->t_;
+    horizonState_.state_ = start->state_;
+    horizonState_.cov_ = start->cov_;
+    horizonState_.mode_ = start->mode_;
+    horizonStates_.resize(n);
+    const int r = prediction->predictHorizon(horizonState_,timeline->measMap_,times,n,horizonStates_.data(),horizonCovs_,reuseJacobians);
+    if(r!=0) std::cout << "Error during predictHorizon: " << r << std::endl;
+    return r == 0;
+  }
+  bool getSafeTime(mtTime& safeTime){
+    if(!getWatermark(safeTime) || safeTime <= safe_.t_){
       safeTime = safe_.t_;
       return false;
     }
     return true;
   }
+  /*!
+   * Time up to which all measurements are available (or have been waited for), irrespective of safe_. It only depends on
+   * the newest measurement of each timeline, and is therefore cached and only recomputed if a timeline is extended.
+   */
+  bool getWatermark(mtTime& watermark){
+    mtTime maxPredictionTime;
+    if(!predictionTimeline_.getLastTime(maxPredictionTime)){
+      return false;
+    }
+    watermark = maxPredictionTime;
+    // Check if we have to wait for update measurements
+    checkUpdateWaitTime(maxPredictionTime,watermark);
+    return true;
+  }
+  void updateWatermark(){
+    hasWatermark_ = getWatermark(safeWatermark_);
+    watermarkValid_ = true;
+  }
+  /*!
+   * Must be called after changing the wait times of the timelines or clearing them.
+   */
+  void invalidateWatermark(){
+    watermarkValid_ = false;
+    safeUpToDate_ = false;
+  }
+  void advanceWatermark(){
+    watermarkValid_ = false;
+    if(autoUpdateSafe_ && !safeUpdateActive_){
+      updateWatermark();
+      if(hasWatermark_ && safeWatermark_ > safe_.t_ && safeWatermark_ >= safe_.t_+mtTimeTraits::fromSeconds(minSafeBatchInterval_)){
+        autoUpdateCount_++;
+        updateSafe();
+      }
+    }
+  }
   template<int i=0, typename std::enable_if<(i<nUpdates_)>::type* = nullptr>
-  void checkUpdateWaitTime(double actualTime,double& time){
+  void checkUpdateWaitTime(mtTime actualTime,mtTime& time){
     std::get<i>(updateTimelineTuple_).waitTime(actualTime,time);
     checkUpdateWaitTime<i+1>(actualTime,time);
   }
   template<int i=0, typename std::enable_if<(i>=nUpdates_)>::type* = nullptr>
-  void checkUpdateWaitTime(double actualTime,double& time){
+  void checkUpdateWaitTime(mtTime actualTime,mtTime& time){
+  }
+  void updateSafe(const mtTime* maxTime = nullptr){
+    const mtTime tOld = safe_.t_;
+    const unsigned int rollbackCountOld = rollbackCount_;
+    safeUpdateActive_ = true;
+    updateSafeBranch(maxTime);
+    safeUpdateActive_ = false;
+    if(safeUpdateCallback_ && (safe_.t_ != tOld || rollbackCount_ != rollbackCountOld)){
+      safeUpdateCallback_(safe_);
+    }
   }
-  void updateSafe(const double* maxTime = nullptr){
-    double nextSafeTime;
-    bool gotSafeTime = getSafeTime(nextSafeTime);
+  void updateSafeBranch(const mtTime* maxTime){
+    drainInputQueues();
+    if(useRollback_){
+      if(checkpoints_.empty()) addCheckpoint();
+      if(rollbackPending_) rollback();
+    }
+    if(!watermarkValid_) updateWatermark();
+    mtTime nextSafeTime = safeWatermark_;
+    bool gotSafeTime = !safeUpToDate_ && hasWatermark_ && nextSafeTime > safe_.t_;
     if(!gotSafeTime || (maxTime != nullptr && *maxTime < safe_.t_)){
+      if(!gotSafeTime) safeUpToDate_ = true;
       if(logCountDiagnostics_){
         std::cout << "Performed safe Update with RegPre: 0, MerPre: 0, BadPre: 0, RegUpd: 0, ComUpd: 0" << std::endl;
       }
       return;
     }
-    if(maxTime != nullptr && nextSafeTime > *maxTime) nextSafeTime = *maxTime;
+    if(maxTime != nullptr && nextSafeTime > *maxTime){
+      nextSafeTime = *maxTime;
+    } else {
+      safeUpToDate_ = true;
+    }
     if(front_.t_<=nextSafeTime && !gotFrontWarning_ && front_.t_>safe_.t_){
       safe_ = front_;
+      if(useStateHistory_) recordState(safe_);
+    }
+    update(safe_,nextSafeTime,useStateHistory_);
+    if(useRollback_){
+      addCheckpoint();
+      clean(checkpoints_.front().t_); // Measurements after the oldest checkpoint are needed for re-running
+    } else {
+      clean(safe_.t_);
     }
-    update(safe_,nextSafeTime);
-    clean(safe_.t_);
     safeWarningTime_ = safe_.t_;
+    if(checkpoints_.empty()) rollbackWarningTime_ = safe_.t_;
     if(logCountDiagnostics_){
-      std::cout << "Performed safe Update with RegPre: " << logCountRegPre_ << ", MerPre: " << logCountMerPre_ << ", BadPre: " << logCountBadPre_ << ", RegUpd: " << logCountRegUpd_ << ", ComUpd: " << logCountComUpd_ << std::endl;
+      std::cout << "Performed safe Update with RegPre: " << logCountRegPre_ << ", MerPre: " << logCountMerPre_ << ", BadPre: " << logCountBadPre_ << ", RegUpd: " << logCountRegUpd_ << ", ComUpd: " << logCountComUpd_ << ", JoiUpd: " << logCountJoiUpd_ << std::endl;
     }
   }
-  void updateFront(const double& tEnd){
+  void updateFront(const mtTime& tEnd){
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     updateSafe();
     if(gotFrontWarning_ || front_.t_<=safe_.t_){
       front_ = safe_;
@@ -202,76 +670,439 @@ class FilterBase: public PropertyHandler{
     update(front_,tEnd);
     frontWarningTime_ = front_.t_;
     gotFrontWarning_ = false;
+    if(frontBudget_ > 0.0){
+      governLatency(std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count());
+    }
+  }
+  void governLatency(double duration){
+    lastFrontDuration_ = duration;
+    if(duration > frontBudget_){
+      overBudgetCount_++;
+      withinBudgetCount_ = 0;
+      if(degradationLevel_ < maxDegradationLevel_) setDegradationLevel(degradationLevel_ == 0 && !mtPrediction::canMerge_ ? 2 : degradationLevel_+1);
+    } else if(duration < recoveryFraction_*frontBudget_){
+      if(++withinBudgetCount_ >= recoveryCount_ && degradationLevel_ > 0){
+        withinBudgetCount_ = 0;
+        setDegradationLevel(degradationLevel_ == 2 && !mtPrediction::canMerge_ ? 0 : degradationLevel_-1);
+      }
+    } else {
+      withinBudgetCount_ = 0;
+    }
+  }
+  /*!
+   * Switches to the given degradation level (see frontBudget_), starting from the nominal settings of the models which
+   * are stored when leaving level 0. Changes of the affected model settings during degradation are therefore lost.
+   */
+  void setDegradationLevel(int level){
+    level = std::max(0,std::min(level,std::min(maxDegradationLevel_,4)));
+    if(level == degradationLevel_) return;
+    std::cout << "[FilterBase::setDegradationLevel] Degradation level " << degradationLevel_ << " -> " << level
+        << " (last updateFront took " << lastFrontDuration_ << " s)" << std::endl;
+    if(degradationLevel_ == 0){
+      saveModelSettings(savedPredictionSettings_,mPrediction_);
+      saveUpdateSettings();
+    }
+    degradationLevel_ = level;
+    degradationChangeCount_++;
+    applyModelSettings(savedPredictionSettings_,mPrediction_);
+    applyUpdateSettings();
+    skippedUpdates_ = 0;
+    if(degradationLevel_ >= 4 && nUpdates_ > 0){
+      int maxPriority = updatePriority_[0];
+      for(int i=1;i<nUpdates_;i++) maxPriority = std::max(maxPriority,updatePriority_[i]);
+      for(int i=0;i<nUpdates_;i++){
+        if(updatePriority_[i] < maxPriority) skippedUpdates_ |= mtEventMask(1) << i;
+      }
+    }
+  }
+  template<typename Model>
+  void saveModelSettings(ModelSettings& settings, const Model& model){
+    settings.useIndividualMode_ = model.useIndividualMode_;
+    settings.mode_ = model.mode_;
+  }
+  template<typename Model>
+  void applyModelSettings(const ModelSettings& settings, Model& model){
+    model.useIndividualMode_ = settings.useIndividualMode_ || degradationLevel_ >= 3;
+    model.mode_ = degradationLevel_ >= 3 ? ModeEKF : settings.mode_;
+  }
+  template<int i=0, typename std::enable_if<(i<nUpdates_)>::type* = nullptr>
+  void saveUpdateSettings(){
+    saveModelSettings(savedUpdateSettings_[i],std::get<i>(mUpdates_));
+    savedUpdateSettings_[i].maxNumIteration_ = std::get<i>(mUpdates_).maxNumIteration_;
+    savedUpdateSettings_[i].useAdaptiveMode_ = std::get<i>(mUpdates_).useAdaptiveMode_;
+    saveUpdateSettings<i+1>();
+  }
+  template<int i=0, typename std::enable_if<(i>=nUpdates_)>::type* = nullptr>
+  void saveUpdateSettings(){
   }
-  void update(mtFilterState& filterState,const double& tEnd){
-    double tNext = filterState.t_;
+  template<int i=0, typename std::enable_if<(i<nUpdates_)>::type* = nullptr>
+  void applyUpdateSettings(){
+    applyModelSettings(savedUpdateSettings_[i],std::get<i>(mUpdates_));
+    std::get<i>(mUpdates_).maxNumIteration_ = degradationLevel_ >= 2 ? std::min(savedUpdateSettings_[i].maxNumIteration_,degradedMaxNumIteration_) : savedUpdateSettings_[i].maxNumIteration_;
+    std::get<i>(mUpdates_).useAdaptiveMode_ = savedUpdateSettings_[i].useAdaptiveMode_ && degradationLevel_ < 3;
+    applyUpdateSettings<i+1>();
+  }
+  template<int i=0, typename std::enable_if<(i>=nUpdates_)>::type* = nullptr>
+  void applyUpdateSettings(){
+  }
+  /*!
+   * Lazy alternative to updateFront for high-rate consumers: requestFront only stores the time, getFront propagates
+   * front_ when it is asked for and only if it is behind the requested time or was invalidated by a late measurement.
+   */
+  void requestFront(mtTime tEnd){
+    frontRequestTime_ = tEnd;
+  }
+  const mtFilterState& getFront(){
+    drainInputQueues();
+    if(gotFrontWarning_ || front_.t_ < frontRequestTime_ || front_.t_ < safe_.t_){
+      updateFront(frontRequestTime_);
+    }
+    return front_;
+  }
+  /*!
+   * Steps through the events of eventIndex_ up to tEnd. The event cursor is invalidated by insertions into eventIndex_,
+   * so no update measurements must be added (e.g. from Update hooks) while update() runs.
+   */
+  void update(mtFilterState& filterState,const mtTime& tEnd,bool recordHistory = false){
+    mtTime tNext = filterState.t_;
     logCountMerPre_ = 0;
     logCountRegPre_ = 0;
     logCountBadPre_ = 0;
     logCountComUpd_ = 0;
     logCountRegUpd_ = 0;
+    logCountJoiUpd_ = 0;
+    typename TimeRingBuffer<mtEventMask,mtTime>::const_iterator itEvent = eventIndex_.upper_bound(filterState.t_);
     while(filterState.t_<tEnd){
       tNext = tEnd;
-      if(!getNextUpdate(filterState.t_,tNext) && updateToUpdateMeasOnly_){
+      eventMask_ = 0;
+      if((itEvent == eventIndex_.end() || itEvent->first >= tEnd) && updateToUpdateMeasOnly_){
         break; // Don't go further if there is no update available
       }
-      int r = 0;
-      if(filterState.usePredictionMerge_){
-        r = mPrediction_.predictMerged(filterState,tNext,predictionTimeline_.measMap_);
-        if(r!=0) std::cout << "Error during predictMerged: " << r << std::endl;
-        logCountMerPre_++;
+      if(itEvent != eventIndex_.end() && itEvent->first <= tEnd){ // Events are visited in order, tNext is reached below
+        tNext = itEvent->first;
+        eventMask_ = itEvent->second & ~skippedUpdates_;
+        ++itEvent;
+      }
+      predict(filterState,tNext,mPrediction_,predictionTimeline_,logCountMerPre_,logCountRegPre_,logCountBadPre_);
+      if(useJointUpdates_ && countJointUpdates(filterState,tNext) > 1){
+        doJointUpdate(filterState,tNext);
       } else {
-        while(filterState.t_ < tNext && (predictionTimeline_.itMeas_ = predictionTimeline_.measMap_.upper_bound(filterState.t_)) != predictionTimeline_.measMap_.end()){
-          r = mPrediction_.performPrediction(filterState,predictionTimeline_.itMeas_->second,std::min(predictionTimeline_.itMeas_->first,tNext)-filterState.t_);
-          if(r!=0) std::cout << "Error during performPrediction: " << r << std::endl;
-          logCountRegPre_++;
-        }
+        doAvailableUpdates(filterState,tNext);
       }
-      if(filterState.t_ < tNext){
-        r = mPrediction_.performPrediction(filterState,tNext-filterState.t_);
+      if(recordHistory) recordState(filterState);
+    }
+  }
+  void startSafeThread(){
+    if(safeThreadRunning_) return;
+    frontPrediction_ = mPrediction_;
+    asyncFront_ = safe_;
+    frontPredictionTimeline_.clear();
+    if(frontPredictionTimeline_.inputQueue_.capacity() != predictionTimeline_.inputQueue_.capacity()){
+      frontPredictionTimeline_.inputQueue_.setCapacity(predictionTimeline_.inputQueue_.capacity()); // Receives the same measurements
+    }
+    publishSafe();
+    asyncFrontVersion_ = publishedVersion_;
+    // Publish the flag before draining: a concurrent push either lands in the safe queue before the drain below or is
+    // also forwarded to the front queue (see pushPredictionMeas), duplicates replace each other in the timeline
+    safeThreadRunning_ = true;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    drainInputQueues();
+    for(auto it = predictionTimeline_.measMap_.upper_bound(safe_.t_);it != predictionTimeline_.measMap_.end();it++){
+      frontPredictionTimeline_.addMeas(it->second,it->first); // Measurements buffered before the start, shared
+    }
+    safeThread_ = std::thread(&FilterBase::runSafeThread,this);
+  }
+  void stopSafeThread(){
+    if(!safeThreadRunning_) return;
+    {
+      std::unique_lock<std::mutex> lock(safeThreadMutex_);
+      safeThreadRunning_ = false;
+    }
+    safeThreadCondition_.notify_one();
+    safeThread_.join();
+  }
+  void runSafeThread(){
+    std::unique_lock<std::mutex> lock(safeThreadMutex_);
+    while(safeThreadRunning_){
+      safeThreadCondition_.wait_for(lock,std::chrono::duration<double>(safeThreadPeriod_),[this]{return !safeThreadRunning_ || safeThreadWakeup_;});
+      safeThreadWakeup_ = false;
+      lock.unlock();
+      const mtTime tOld = safe_.t_;
+      const unsigned int rollbackCountOld = rollbackCount_;
+      updateSafe();
+      if(safe_.t_ != tOld || rollbackCount_ != rollbackCountOld) publishSafe();
+      lock.lock();
+    }
+  }
+  void publishSafe(){
+    const int back = 1-publishedIndex_; // Only the background thread changes publishedIndex_
+    publishedSafe_[back] = safe_;
+    std::lock_guard<std::mutex> lock(publishMutex_);
+    publishedIndex_ = back;
+    publishedVersion_++;
+  }
+  /*!
+   * Front branch of the two-thread operation: restarts from the latest published safe snapshot if there is a new one and
+   * predicts asyncFront_ up to tEnd with the buffered prediction measurements. No updates are performed.
+   */
+  const mtFilterState& predictFront(const mtTime& tEnd){
+    refreshFront();
+    if(asyncFront_.t_ < tEnd){
+      predict(asyncFront_,tEnd,frontPrediction_,frontPredictionTimeline_,frontCountPre_[0],frontCountPre_[1],frontCountPre_[2]);
+    }
+    return asyncFront_;
+  }
+  /*!
+   * Moves the pushed prediction measurements into frontPredictionTimeline_ and restarts asyncFront_ from the latest
+   * published safe snapshot if there is a new one.
+   */
+  void refreshFront(){
+    std::pair<mtTime,typename MeasurementTimeline<typename Prediction::mtMeas,mtTime>::mtMeasPtr> entry;
+    while(frontPredictionTimeline_.inputQueue_.pop(entry)){
+      frontPredictionTimeline_.addMeas(entry.second,entry.first);
+    }
+    if(publishedVersion_ != asyncFrontVersion_){
+      std::lock_guard<std::mutex> lock(publishMutex_);
+      asyncFront_ = publishedSafe_[publishedIndex_];
+      asyncFrontVersion_ = publishedVersion_;
+      frontPredictionTimeline_.clean(asyncFront_.t_); // Later snapshots are not older
+    }
+  }
+  /*!
+   * Prediction part of update(), with the model and timeline as arguments such that predictFront can use its own.
+   */
+  void predict(mtFilterState& filterState, const mtTime& tNext, mtPrediction& prediction, MeasurementTimeline<typename mtPrediction::mtMeas,mtTime>& timeline,
+               unsigned int& countMerPre, unsigned int& countRegPre, unsigned int& countBadPre){
+    int r = 0;
+    if(filterState.usePredictionMerge_ || (degradationLevel_ >= 1 && mtPrediction::canMerge_)){
+      r = prediction.predictMerged(filterState,tNext,timeline.measMap_);
+      if(r!=0) std::cout << "Error during predictMerged: " << r << std::endl;
+      countMerPre++;
+    } else {
+      while(filterState.t_ < tNext && (timeline.itMeas_ = timeline.measMap_.upper_bound(filterState.t_)) != timeline.measMap_.end()){
+        const mtTime tStep = std::min(timeline.itMeas_->first,tNext);
+        r = prediction.performPrediction(filterState,*timeline.itMeas_->second,mtTimeTraits::toSeconds(tStep-filterState.t_));
+        filterState.t_ = tStep; // The time stamp advanced by the model went through seconds and may be rounded
         if(r!=0) std::cout << "Error during performPrediction: " << r << std::endl;
-        logCountBadPre_++;
+        countRegPre++;
       }
-      doAvailableUpdates(filterState,tNext);
     }
-  }
-  template<int i=0, typename std::enable_if<(i<nUpdates_)>::type* = nullptr>
-  bool getNextUpdate(double actualTime, double& nextTime){
-    double tNextUpdate;
-    bool gotMatchingUpdate = false;
-    if(std::get<i>(updateTimelineTuple_).getNextTime(actualTime,tNextUpdate) && tNextUpdate < nextTime){
-      gotMatchingUpdate = true;
-      nextTime = tNextUpdate;
+    if(filterState.t_ < tNext){
+      r = prediction.performPrediction(filterState,mtTimeTraits::toSeconds(tNext-filterState.t_));
+      filterState.t_ = tNext;
+      if(r!=0) std::cout << "Error during performPrediction: " << r << std::endl;
+      countBadPre++;
     }
-    return gotMatchingUpdate | getNextUpdate<i+1>(actualTime, nextTime);
   }
-  template<int i=0, typename std::enable_if<(i>=nUpdates_)>::type* = nullptr>
-  bool getNextUpdate(double actualTime, double& nextTime){
-    return false;
+  template<int i>
+  bool hasEvent() const{
+    return (eventMask_ & (mtEventMask(1) << i)) != 0;
   }
   template<int i=0, typename std::enable_if<(i<nUpdates_)>::type* = nullptr>
-  void doAvailableUpdates(mtFilterState& filterState, double tNext){
-    if(std::get<i>(updateTimelineTuple_).hasMeasurementAt(tNext)){
-          int r = std::get<i>(mUpdates_).performUpdate(filterState,std::get<i>(updateTimelineTuple_).measMap_[tNext]);
+  void doAvailableUpdates(mtFilterState& filterState, mtTime tNext){
+    typename std::tuple_element<i,mtUpdates>::type::mtMeas* meas = hasEvent<i>() ? std::get<i>(updateTimelineTuple_).findMeas(tNext) : nullptr;
+    if(meas != nullptr){
+          std::get<i>(updateTimelineTuple_).waitForPending(tNext);
+          int r = std::get<i>(mUpdates_).performUpdate(filterState,*meas);
           if(r!=0) std::cout << "Error during update: " << r << std::endl;
           logCountRegUpd_++;
     }
     doAvailableUpdates<i+1>(filterState,tNext);
   }
   template<int i=0, typename std::enable_if<(i>=nUpdates_)>::type* = nullptr>
-  void doAvailableUpdates(mtFilterState& filterState, double tNext){
+  void doAvailableUpdates(mtFilterState& filterState, mtTime tNext){
+  }
+  template<int i>
+  bool isJointUpdateCandidate(const mtFilterState& filterState, mtTime tNext){
+    return !std::tuple_element<i,mtUpdates>::type::coupledToPrediction_
+        && std::get<i>(mUpdates_).getMode(filterState) == ModeEKF
+        && !std::get<i>(mUpdates_).useAdaptiveMode_
+        && !std::get<i>(mUpdates_).useSpecialLinearizationPoint_
+        && !std::get<i>(mUpdates_).useNullSpaceProjection_
+        && !std::get<i>(mUpdates_).usePreGating_
+        && !std::get<i>(mUpdates_).useOutlierCompaction_
+        && hasEvent<i>();
+  }
+  template<int i=0, typename std::enable_if<(i<nUpdates_)>::type* = nullptr>
+  int countJointUpdates(const mtFilterState& filterState, mtTime tNext){
+    return (isJointUpdateCandidate<i>(filterState,tNext) ? 1 : 0) + countJointUpdates<i+1>(filterState,tNext);
+  }
+  template<int i=0, typename std::enable_if<(i>=nUpdates_)>::type* = nullptr>
+  int countJointUpdates(const mtFilterState& filterState, mtTime tNext){
+    return 0;
+  }
+  /*!
+   * Stacks the innovations of all update types with a measurement at tNext and performs a single EKF update. Only the
+   * active types are stacked, each keeps its own outlier detection and receives its slices of Py_, Pyinv_, K_ and Hlin_
+   * for postprocessing. Types which are coupled to the prediction, use a special linearization point, null-space
+   * projection, pre-gating or outlier compaction or do not run in (non-adaptive) EKF mode, as well as additional passes
+   * requested by postProcess, are handled individually.
+   */
+  void doJointUpdate(mtFilterState& filterState, mtTime tNext){
+    jointInnovationDimActive_ = 0;
+    linearizeJointUpdate(filterState,tNext);
+    if(jointInnovationDimActive_ > 0){
+      jointH_.resize(jointInnovationDimActive_,D_);
+      jointPy_.setZero(jointInnovationDimActive_,jointInnovationDimActive_);
+      jointInnVector_.resize(jointInnovationDimActive_);
+      stackJointUpdate();
+      jointPyx_.noalias() = jointH_*filterState.cov_;
+      jointPy_.noalias() += jointPyx_*jointH_.transpose();
+      jointOutlierDetection();
+      jointPyx_.noalias() = jointH_*filterState.cov_;
+      jointPyLLT_.compute(jointPy_);
+      jointK_ = jointPyLLT_.solve(jointPyx_).transpose();
+      jointPyinv_.setIdentity(jointInnovationDimActive_,jointInnovationDimActive_);
+      jointPyLLT_.solveInPlace(jointPyinv_);
+      filterState.cov_.noalias() -= jointK_*jointPyx_;
+      jointUpdateVec_ = -jointK_*jointInnVector_;
+      filterState.state_.boxPlus(jointUpdateVec_,filterState.state_);
+      filterState.state_.fix();
+      enforceSymmetry(filterState.cov_);
+      distributeJointUpdate();
+      logCountJoiUpd_++;
+    }
+    finishJointUpdate(filterState,tNext);
+  }
+  template<int i=0, typename std::enable_if<(i<nUpdates_)>::type* = nullptr>
+  void linearizeJointUpdate(mtFilterState& filterState, mtTime tNext){
+    typedef typename std::tuple_element<i,mtUpdates>::type mtUpdate;
+    mtUpdate& update = std::get<i>(mUpdates_);
+    jointActive_[i] = false;
+    const typename mtUpdate::mtMeas* meas = isJointUpdateCandidate<i>(filterState,tNext) ? std::get<i>(updateTimelineTuple_).findMeas(tNext) : nullptr;
+    if(meas != nullptr){
+      std::get<i>(updateTimelineTuple_).waitForPending(tNext);
+      bool isFinished = true;
+      update.preProcess(filterState,*meas,isFinished);
+      if(!isFinished){
+        jointActive_[i] = true;
+        jointOffset_[i] = jointInnovationDimActive_;
+        jointInnovationDimActive_ += mtUpdate::mtInnovation::D_;
+        update.linearizeInnovation(filterState.state_,*meas);
+      }
+    }
+    linearizeJointUpdate<i+1>(filterState,tNext);
+  }
+  template<int i=0, typename std::enable_if<(i>=nUpdates_)>::type* = nullptr>
+  void linearizeJointUpdate(mtFilterState& filterState, mtTime tNext){
+  }
+  template<int i=0, typename std::enable_if<(i<nUpdates_)>::type* = nullptr>
+  void stackJointUpdate(){
+    typedef typename std::tuple_element<i,mtUpdates>::type mtUpdate;
+    const int dI = mtUpdate::mtInnovation::D_;
+    const mtUpdate& update = std::get<i>(mUpdates_);
+    if(jointActive_[i]){
+      jointH_.block(jointOffset_[i],0,dI,D_) = update.H_;
+      jointPy_.block(jointOffset_[i],jointOffset_[i],dI,dI) = update.Hn_*update.updnoiP_*update.Hn_.transpose();
+      jointInnVector_.segment(jointOffset_[i],dI) = update.innVector_;
+    }
+    stackJointUpdate<i+1>();
+  }
+  template<int i=0, typename std::enable_if<(i>=nUpdates_)>::type* = nullptr>
+  void stackJointUpdate(){
+  }
+  template<int i=0, typename std::enable_if<(i<nUpdates_)>::type* = nullptr>
+  void jointOutlierDetection(){
+    typedef typename std::tuple_element<i,mtUpdates>::type mtUpdate;
+    mtUpdate& update = std::get<i>(mUpdates_);
+    if(jointActive_[i]){
+      update.innVector_ = jointInnVector_.segment(jointOffset_[i],mtUpdate::mtInnovation::D_);
+      update.outlierDetection_.doOutlierDetection(update.innVector_,jointPy_,jointH_,jointOffset_[i]);
+    }
+    jointOutlierDetection<i+1>();
+  }
+  template<int i=0, typename std::enable_if<(i>=nUpdates_)>::type* = nullptr>
+  void jointOutlierDetection(){
+  }
+  template<int i=0, typename std::enable_if<(i<nUpdates_)>::type* = nullptr>
+  void distributeJointUpdate(){
+    typedef typename std::tuple_element<i,mtUpdates>::type mtUpdate;
+    const int dI = mtUpdate::mtInnovation::D_;
+    mtUpdate& update = std::get<i>(mUpdates_);
+    if(jointActive_[i]){
+      update.Hlin_ = jointH_.block(jointOffset_[i],0,dI,D_);
+      update.Py_ = jointPy_.block(jointOffset_[i],jointOffset_[i],dI,dI);
+      update.Pyinv_ = jointPyinv_.block(jointOffset_[i],jointOffset_[i],dI,dI);
+      update.K_ = jointK_.middleCols(jointOffset_[i],dI);
+    }
+    distributeJointUpdate<i+1>();
+  }
+  template<int i=0, typename std::enable_if<(i>=nUpdates_)>::type* = nullptr>
+  void distributeJointUpdate(){
+  }
+  template<int i=0, typename std::enable_if<(i<nUpdates_)>::type* = nullptr>
+  void finishJointUpdate(mtFilterState& filterState, mtTime tNext){
+    typedef typename std::tuple_element<i,mtUpdates>::type mtUpdate;
+    mtUpdate& update = std::get<i>(mUpdates_);
+    MeasurementTimeline<typename mtUpdate::mtMeas,mtTime>& timeline = std::get<i>(updateTimelineTuple_);
+    typename mtUpdate::mtMeas* meas = hasEvent<i>() ? timeline.findMeas(tNext) : nullptr;
+    if(meas != nullptr){
+      timeline.waitForPending(tNext);
+      bool isFinished = true;
+      if(isJointUpdateCandidate<i>(filterState,tNext)){
+        update.postProcess(filterState,*meas,update.outlierDetection_,isFinished);
+        filterState.state_.fix();
+        enforceSymmetry(filterState.cov_);
+      } else {
+        isFinished = false;
+      }
+      if(!isFinished){
+        int r = update.performUpdate(filterState,*meas);
+        if(r!=0) std::cout << "Error during update: " << r << std::endl;
+        logCountRegUpd_++;
+      }
+    }
+    finishJointUpdate<i+1>(filterState,tNext);
+  }
+  template<int i=0, typename std::enable_if<(i>=nUpdates_)>::type* = nullptr>
+  void finishJointUpdate(mtFilterState& filterState, mtTime tNext){
+  }
+  /*!
+   * Approximate memory usage in bytes, broken down by component (filter states, models, timelines and workspaces).
+   */
+  std::map<std::string,size_t> memoryFootprint() const{
+    std::map<std::string,size_t> footprint;
+    footprint["safe"] = safe_.memoryFootprint();
+    footprint["front"] = front_.memoryFootprint();
+    footprint["init"] = init_.memoryFootprint();
+    footprint["prediction"] = mPrediction_.memoryFootprint();
+    footprint["predictionTimeline"] = predictionTimeline_.memoryFootprint();
+    footprint["eventIndex"] = eventIndex_.capacity()*sizeof(typename TimeRingBuffer<mtEventMask,mtTime>::value_type);
+    footprint["jointUpdate"] = heapMemory(jointH_,jointPy_,jointPyx_,jointK_,jointPyinv_,jointInnVector_);
+    footprint["horizon"] = horizonState_.memoryFootprint() + horizonStates_.capacity()*sizeof(mtState) + heapMemory(horizonCovs_);
+    footprint["asyncFront"] = asyncFront_.memoryFootprint() + frontPrediction_.memoryFootprint() + frontPredictionTimeline_.memoryFootprint() + publishedSafe_[0].memoryFootprint() + publishedSafe_[1].memoryFootprint();
+    footprint["checkpoints"] = checkpoints_.empty() ? 0 : checkpoints_.size()*checkpoints_.front().memoryFootprint();
+    footprint["stateHistory"] = stateHistory_.size()*sizeof(StateHistoryEntry);
+    for(const StateHistoryEntry& entry : stateHistory_) footprint["stateHistory"] += heapMemory(entry.covBlocks_);
+    addUpdateMemoryFootprint(footprint);
+    size_t total = 0;
+    for(auto it = footprint.begin();it != footprint.end();it++){
+      total += it->second;
+    }
+    footprint["total"] = total;
+    return footprint;
+  }
+  template<int i=0, typename std::enable_if<(i<nUpdates_)>::type* = nullptr>
+  void addUpdateMemoryFootprint(std::map<std::string,size_t>& footprint) const{
+    footprint["update" + std::to_string(i)] = std::get<i>(mUpdates_).memoryFootprint();
+    footprint["updateTimeline" + std::to_string(i)] = std::get<i>(updateTimelineTuple_).memoryFootprint();
+    addUpdateMemoryFootprint<i+1>(footprint);
+  }
+  template<int i=0, typename std::enable_if<(i>=nUpdates_)>::type* = nullptr>
+  void addUpdateMemoryFootprint(std::map<std::string,size_t>& footprint) const{
   }
-  void clean(const double& t){
+  void clean(const mtTime& t){
     predictionTimeline_.clean(t);
     cleanUpdateTimeline(t);
+    eventIndex_.erase(eventIndex_.begin(),eventIndex_.upper_bound(t));
   }
   template<int i=0, typename std::enable_if<(i<nUpdates_)>::type* = nullptr>
-  void cleanUpdateTimeline(const double& t){
+  void cleanUpdateTimeline(const mtTime& t){
     std::get<i>(updateTimelineTuple_).clean(t);
     cleanUpdateTimeline<i+1>(t);
   }
   template<int i=0, typename std::enable_if<(i>=nUpdates_)>::type* = nullptr>
-  void cleanUpdateTimeline(const double& t){
+  void cleanUpdateTimeline(const mtTime& t){
   }
 };
 
@@ -10,56 +10,44 @@
 
 #include "lightweight_filtering/common.hpp"
 #include "lightweight_filtering/SigmaPoints.hpp"
+#include "lightweight_filtering/TimeTraits.hpp"
 
 namespace LWF{
 
-template<typename State, typename PredictionMeas, typename PredictionNoise, unsigned int noiseExtensionDim = 0>
-class FilterState{
+/*!
+ * Workspace of the prediction (Jacobians and sigma points). It is owned by the prediction model such that copies of the
+ * filter state (safe, front, checkpoints, ...) only carry the estimate. Coupled updates read G_ and the sigma points of
+ * the last prediction through FilterState::predictionWorkspace_.
+ */
+template<typename State, typename PredictionNoise, unsigned int noiseExtensionDim = 0>
+class PredictionWorkspace{
  public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   typedef State mtState;
-  typedef PredictionMeas mtPredictionMeas;
   typedef PredictionNoise mtPredictionNoise;
-  FilteringMode mode_;
-  bool usePredictionMerge_;
-  static constexpr unsigned int noiseExtensionDim_ = noiseExtensionDim;
-  double t_;
-  mtState state_;
-  Eigen::MatrixXd cov_;
   Eigen::MatrixXd F_;
   Eigen::MatrixXd G_;
   SigmaPoints<mtState,2*mtState::D_+1,2*(mtState::D_+mtPredictionNoise::D_+noiseExtensionDim)+1,0> stateSigmaPoints_;
   SigmaPoints<mtPredictionNoise,2*mtPredictionNoise::D_+1,2*(mtState::D_+mtPredictionNoise::D_+noiseExtensionDim)+1,2*mtState::D_> stateSigmaPointsNoi_;
   SigmaPoints<mtState,2*(mtState::D_+mtPredictionNoise::D_)+1,2*(mtState::D_+mtPredictionNoise::D_+noiseExtensionDim)+1,0> stateSigmaPointsPre_;
   Eigen::MatrixXd prenoiP_; // automatic change tracking
-  typename mtState::mtDifVec difVecLin_;
-  double alpha_;
-  double beta_;
-  double kappa_;
-  FilterState():  cov_((int)(mtState::D_),(int)(mtState::D_)),
-                  F_((int)(mtState::D_),(int)(mtState::D_)),
-                  G_((int)(mtState::D_),(int)(mtPredictionNoise::D_)),
-                  prenoiP_((int)(mtPredictionNoise::D_),(int)(mtPredictionNoise::D_)){
-    alpha_ = 1e-3;
-    beta_ = 2.0;
-    kappa_ = 0.0;
-    mode_ = ModeEKF;
-    usePredictionMerge_ = false;
-    t_ = 0.0;
-    state_.setIdentity();
-    cov_.setIdentity();
+  PredictionWorkspace():  F_((int)(mtState::D_),(int)(mtState::D_)),
+                          G_((int)(mtState::D_),(int)(mtPredictionNoise::D_)),
+                          prenoiP_((int)(mtPredictionNoise::D_),(int)(mtPredictionNoise::D_)){
     F_.setIdentity();
     G_.setZero();
     prenoiP_.setIdentity();
     prenoiP_ *= 0.0001;
-    difVecLin_.setIdentity();
-    refreshUKFParameter();
   }
-  virtual ~FilterState(){};
-  void refreshUKFParameter(){
-    stateSigmaPoints_.computeParameter(alpha_,beta_,kappa_);
-    stateSigmaPointsNoi_.computeParameter(alpha_,beta_,kappa_);
-    stateSigmaPointsPre_.computeParameter(alpha_,beta_,kappa_);
+  virtual ~PredictionWorkspace(){};
+  size_t dynamicMemoryFootprint() const{
+    return heapMemory(F_,G_,prenoiP_) + stateSigmaPoints_.dynamicMemoryFootprint()
+        + stateSigmaPointsNoi_.dynamicMemoryFootprint() + stateSigmaPointsPre_.dynamicMemoryFootprint();
+  }
+  void refreshUKFParameter(double alpha, double beta, double kappa){
+    stateSigmaPoints_.computeParameter(alpha,beta,kappa);
+    stateSigmaPointsNoi_.computeParameter(alpha,beta,kappa);
+    stateSigmaPointsPre_.computeParameter(alpha,beta,kappa);
     stateSigmaPointsNoi_.computeFromZeroMeanGaussian(prenoiP_);
   }
   void refreshNoiseSigmaPoints(const Eigen::MatrixXd& prenoiP){
@@ -70,6 +58,57 @@ class FilterState{
   }
 };
 
+template<typename State, typename PredictionMeas, typename PredictionNoise, unsigned int noiseExtensionDim = 0, typename Time = double>
+class FilterState{
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  typedef State mtState;
+  typedef PredictionMeas mtPredictionMeas;
+  typedef PredictionNoise mtPredictionNoise;
+  typedef Time mtTime; // See TimeTraits
+  typedef PredictionWorkspace<State,PredictionNoise,noiseExtensionDim> mtPredictionWorkspace;
+  FilteringMode mode_;
+  FilteringMode predictionMode_; // Mode of the last prediction, coupled updates depend on its workspace (G_ or stateSigmaPointsPre_)
+  const mtPredictionWorkspace* predictionWorkspace_; // Workspace of the last prediction (not owned, set by the prediction model, reset on copy)
+  bool usePredictionMerge_;
+  static constexpr unsigned int noiseExtensionDim_ = noiseExtensionDim;
+  mtTime t_;
+  mtState state_;
+  Eigen::MatrixXd cov_;
+  typename mtState::mtDifVec difVecLin_;
+  FilterState(): cov_((int)(mtState::D_),(int)(mtState::D_)){
+    mode_ = ModeEKF;
+    predictionMode_ = ModeEKF;
+    predictionWorkspace_ = nullptr;
+    usePredictionMerge_ = false;
+    t_ = 0;
+    state_.setIdentity();
+    cov_.setIdentity();
+    difVecLin_.setIdentity();
+  }
+  /*!
+   * Copies carry the estimate only, predictionWorkspace_ is reset since the workspace belongs to the model which
+   * predicted the original (a coupled update of a copy requires a prediction of its own first).
+   */
+  FilterState(const FilterState& other): mode_(other.mode_), predictionMode_(other.predictionMode_), predictionWorkspace_(nullptr),
+      usePredictionMerge_(other.usePredictionMerge_), t_(other.t_), state_(other.state_), cov_(other.cov_), difVecLin_(other.difVecLin_){}
+  FilterState& operator=(const FilterState& other){
+    mode_ = other.mode_;
+    predictionMode_ = other.predictionMode_;
+    predictionWorkspace_ = nullptr;
+    usePredictionMerge_ = other.usePredictionMerge_;
+    t_ = other.t_;
+    state_ = other.state_;
+    cov_ = other.cov_;
+    difVecLin_ = other.difVecLin_;
+    return *this;
+  }
+  virtual ~FilterState(){};
+  size_t memoryFootprint() const{
+    return sizeof(*this) + heapMemory(cov_);
+  }
+};
+
 }
 
 #endif /* LWF_FILTERSTATE_HPP_ */
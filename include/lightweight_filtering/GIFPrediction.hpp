@@ -11,6 +11,7 @@
 #include "lightweight_filtering/common.hpp"
 #include "lightweight_filtering/ModelBase.hpp"
 #include "lightweight_filtering/PropertyHandler.hpp"
+#include "lightweight_filtering/MeasurementTimeline.hpp"
 
 namespace LWF{
 
@@ -25,6 +26,8 @@ class GIFPrediction: public ModelBase<GIFPrediction<FilterState,Innovation,Meas,
   typedef typename mtFilterState::mtState mtState;
   typedef Meas mtMeas;
   typedef Noise mtNoise;
+  typedef typename mtFilterState::mtTime mtTime;
+  static const bool canMerge_ = false; // predictMerged is not supported
   Eigen::MatrixXd noiP_;
   Eigen::MatrixXd noiPwgt_;
   Eigen::MatrixXd noiPinv_;
@@ -36,7 +39,7 @@ class GIFPrediction: public ModelBase<GIFPrediction<FilterState,Innovation,Meas,
   mtInnovation r_;
   typename mtInnovation::mtDifVec dr_;
   typename mtState::mtDifVec dx_;
-  mtMeas meas_;
+  const mtMeas* meas_; // Measurement of the ongoing prediction (not owned)
   Eigen::MatrixXd A00_;
   Eigen::MatrixXd A01_;
   Eigen::MatrixXd A11_;
@@ -58,9 +61,13 @@ class GIFPrediction: public ModelBase<GIFPrediction<FilterState,Innovation,Meas,
     n.setIdentity();
     n.registerCovarianceToPropertyHandler_(noiP_,this,"Noise.");
     disablePreAndPostProcessingWarning_ = false;
+    meas_ = nullptr;
     refreshProperties();
   };
   virtual ~GIFPrediction(){};
+  size_t memoryFootprint() const{
+    return sizeof(*this) + heapMemory(noiP_,noiPwgt_,noiPinv_,jacPreviousState_,jacCurrentState_,jacNoise_,A00_,A01_,A11_,S_,Sinv_);
+  }
   void refreshProperties(){
     noiPinv_.setIdentity();
 //    noiP_.llt().solveInPlace(noiPinv_); // TODO: fix and improve
@@ -107,7 +114,8 @@ class GIFPrediction: public ModelBase<GIFPrediction<FilterState,Innovation,Meas,
     return performPrediction(filterState,meas,dt);
   }
   int performPrediction(mtFilterState& filterState, const mtMeas& meas, double dt){
-    meas_ = meas;
+    PointerGuard<const mtMeas> measGuard(meas_);
+    meas_ = &meas;
     preProcess(filterState,meas,dt);
     getLinearizationPoint(stateCurrentLin_,filterState,meas,dt);
     jacPreviousState(jacPreviousState_,filterState.state_,stateCurrentLin_,dt);
@@ -138,14 +146,14 @@ class GIFPrediction: public ModelBase<GIFPrediction<FilterState,Innovation,Meas,
     if(!dx_.allFinite()) std::cout << "dx_ is BAD after inverse" << std::endl;
     stateCurrentLin_.boxPlus(dx_,filterState.state_);
     filterState.state_.fix();
-    filterState.t_ += dt;
+    filterState.t_ += TimeTraits<mtTime>::fromSeconds(dt);
     postProcess(filterState,meas,dt);
     return 0;
   }
   virtual void getLinearizationPoint(mtState& state1, const mtFilterState& filterState, const mtMeas& meas, double dt){
     state1 = filterState.state_;
   };
-  int predictMerged(mtFilterState& filterState, double tTarget, const std::map<double,mtMeas>& measMap){
+  int predictMerged(mtFilterState& filterState, mtTime tTarget, const typename MeasurementTimeline<mtMeas,mtTime>::mtMeasMap& measMap){
     std::cout << "\033[31mGIF predictions cannot be merged!\033[0m" << std::endl;
     return 1;
   }
@@ -160,11 +168,12 @@ class GIFPrediction: public ModelBase<GIFPrediction<FilterState,Innovation,Meas,
     return testPredictionJacs(previousState,currentState,meas,d,th,dt);
   }
   bool testPredictionJacs(const mtState& previousState,const mtState& currentState, const mtMeas& meas, double d = 1e-6,double th = 1e-6,double dt = 0.1){
+    PointerGuard<const mtMeas> measGuard(meas_);
     mtInputTuple inputs;
     std::get<0>(inputs) = previousState;
     std::get<1>(inputs) = currentState;
     std::get<2>(inputs).setIdentity(); // Noise is always set to zero for Jacobians
-    meas_ = meas;
+    meas_ = &meas;
     return this->testJacs(inputs,d,th,dt);
   }
 };
@@ -0,0 +1,104 @@
+/*
+ * LockFreeQueue.hpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LWF_LOCKFREEQUEUE_HPP_
+#define LWF_LOCKFREEQUEUE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace LWF{
+
+/*!
+ * Bounded lock-free queue for any number of producer threads and a single consumer thread (the filter). Each cell
+ * carries a sequence number which tells producers and the consumer whether it is free or filled, such that only the
+ * position counters have to be shared. The capacity is rounded up to a power of two.
+ */
+template<typename T>
+class LockFreeQueue{
+ public:
+  LockFreeQueue(size_t capacity = 1024){
+    setCapacity(capacity);
+  };
+  virtual ~LockFreeQueue(){};
+  LockFreeQueue(const LockFreeQueue&) = delete;
+  LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+  /*!
+   * Reallocates the buffer, queued entries are dropped. Not thread-safe, must not be called while other threads push.
+   */
+  void setCapacity(size_t capacity){
+    size_t n = 2;
+    while(n < capacity) n *= 2;
+    buffer_.reset(new Cell[n]);
+    mask_ = n-1;
+    for(size_t i=0;i<n;i++){
+      buffer_[i].sequence_.store(i,std::memory_order_relaxed);
+    }
+    enqueuePos_.store(0,std::memory_order_relaxed);
+    dequeuePos_.store(0,std::memory_order_relaxed);
+  }
+  size_t capacity() const{
+    return mask_+1;
+  }
+  size_t memoryFootprint() const{
+    return sizeof(*this) + capacity()*sizeof(Cell);
+  }
+  /*!
+   * Thread-safe, returns false if the queue is full.
+   */
+  bool push(const T& data){
+    return push(T(data));
+  }
+  bool push(T&& data){
+    Cell* cell;
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    while(true){
+      cell = &buffer_[pos & mask_];
+      const intptr_t dif = (intptr_t)cell->sequence_.load(std::memory_order_acquire) - (intptr_t)pos;
+      if(dif == 0){
+        if(enqueuePos_.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed)) break;
+      } else if(dif < 0){
+        return false;
+      } else {
+        pos = enqueuePos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data_ = std::move(data);
+    cell->sequence_.store(pos+1,std::memory_order_release);
+    return true;
+  }
+  /*!
+   * Must only be called from the consumer thread, returns false if the queue is empty.
+   */
+  bool pop(T& data){
+    const size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    Cell* cell = &buffer_[pos & mask_];
+    if(cell->sequence_.load(std::memory_order_acquire) != pos+1) return false;
+    data = std::move(cell->data_);
+    cell->data_ = T();
+    cell->sequence_.store(pos+mask_+1,std::memory_order_release);
+    dequeuePos_.store(pos+1,std::memory_order_relaxed);
+    return true;
+  }
+  bool empty() const{
+    const size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    return buffer_[pos & mask_].sequence_.load(std::memory_order_acquire) != pos+1;
+  }
+ private:
+  struct Cell{
+    std::atomic<size_t> sequence_;
+    T data_;
+  };
+  std::unique_ptr<Cell[]> buffer_;
+  size_t mask_;
+  std::atomic<size_t> enqueuePos_;
+  std::atomic<size_t> dequeuePos_;
+};
+
+}
+
+#endif /* LWF_LOCKFREEQUEUE_HPP_ */
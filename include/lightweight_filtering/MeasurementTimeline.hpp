@@ -0,0 +1,203 @@
+/*
+ * MeasurementTimeline.hpp
+ *
+ *  Created on: Feb 9, 2014
+ *      Author: Bloeschm
+ */
+
+#ifndef LWF_MEASUREMENTTIMELINE_HPP_
+#define LWF_MEASUREMENTTIMELINE_HPP_
+
+#include "lightweight_filtering/common.hpp"
+#include "lightweight_filtering/TimeRingBuffer.hpp"
+#include "lightweight_filtering/TimeTraits.hpp"
+#include "lightweight_filtering/LockFreeQueue.hpp"
+#include <functional>
+#include <future>
+#include <memory>
+#include <Eigen/StdVector>
+
+namespace LWF{
+
+template<typename Meas, typename Time = double>
+class MeasurementTimeline{
+ public:
+  typedef Meas mtMeas;
+  typedef Time mtTime;
+  typedef std::shared_ptr<mtMeas> mtMeasPtr; // Shared ownership, measurements are not copied once they are in the timeline
+  typedef TimeRingBuffer<mtMeasPtr,mtTime> mtMeasMap; // Contiguous and time-sorted, see TimeRingBuffer
+  mtMeasMap measMap_;
+  typename mtMeasMap::iterator itMeas_;
+  std::map<mtTime,std::shared_future<void>> pendingMap_; // Asynchronous preprocessing of measurements in measMap_
+  LockFreeQueue<std::pair<mtTime,mtMeasPtr>> inputQueue_; // Measurements pushed by sensor threads, not yet in measMap_ (capacity see LockFreeQueue::setCapacity)
+  double maxWaitTime_; // [s]
+  double minWaitTime_; // [s]
+  unsigned int maxSize_; // Capacity of measMap_ (at least 2), 0 for unlimited
+  CapacityPolicy capacityPolicy_;
+  std::function<void(const mtMeas& older, mtTime tOlder, mtMeas& newer, mtTime tNewer)> mergeMeas_; // For PolicyDecimate, the newer measurement is used for the whole interval if not set
+  std::function<void(const mtMeasPtr& meas, mtTime t)> spillMeas_; // For PolicySpill
+  unsigned int countDropped_;
+  unsigned int countRejected_;
+  unsigned int countDecimated_;
+  unsigned int countSpilled_;
+  MeasurementTimeline(){
+    maxWaitTime_ = 0.1;
+    minWaitTime_ = 0.0;
+    maxSize_ = 0;
+    capacityPolicy_ = PolicyDropOldest;
+    countDropped_ = 0;
+    countRejected_ = 0;
+    countDecimated_ = 0;
+    countSpilled_ = 0;
+  };
+  virtual ~MeasurementTimeline(){
+    waitForPending();
+  };
+  template<typename... Args>
+  static mtMeasPtr makeMeasPtr(Args&&... args){
+    return std::allocate_shared<mtMeas>(Eigen::aligned_allocator<mtMeas>(),std::forward<Args>(args)...);
+  }
+  /*!
+   * Returns false if the measurement was rejected because the timeline is full (PolicyReject), or if it is older than
+   * all measurements of a full timeline. In the latter case it is not inserted but reduced right away according to
+   * capacityPolicy_ (dropped, merged into the oldest measurement or spilled).
+   */
+  bool addMeas(const mtMeasPtr& meas, const mtTime& t){
+    waitForPending(t);
+    if(maxSize_ > 0 && measMap_.size() >= std::max(maxSize_,2u) && capacityPolicy_ == PolicyReject && measMap_.count(t) == 0){
+      countRejected_++;
+      return false;
+    }
+    if(maxSize_ > 0 && measMap_.size() >= std::max(maxSize_,2u) && t < measMap_.begin()->first){
+      reduceMeas(meas,t,measMap_.begin());
+      return false;
+    }
+    measMap_[t] = meas;
+    while(maxSize_ > 0 && measMap_.size() > std::max(maxSize_,2u)){
+      reduceOldest();
+    }
+    return true;
+  }
+  bool addMeas(const mtMeas& meas, const mtTime& t){
+    return addMeas(makeMeasPtr(meas),t);
+  }
+  bool addMeas(mtMeas&& meas, const mtTime& t){
+    return addMeas(makeMeasPtr(std::move(meas)),t);
+  }
+  template<typename... Args>
+  bool emplaceMeas(const mtTime& t, Args&&... args){
+    return addMeas(makeMeasPtr(std::forward<Args>(args)...),t);
+  }
+  /*!
+   * Removes the oldest measurement according to capacityPolicy_.
+   */
+  void reduceOldest(){
+    typename mtMeasMap::iterator itOldest = measMap_.begin();
+    waitForPending(itOldest->first);
+    reduceMeas(itOldest->second,itOldest->first,std::next(itOldest));
+    measMap_.erase(itOldest);
+  }
+  /*!
+   * Applies capacityPolicy_ to the measurement at t, itNext is the following measurement in measMap_ (merge target of
+   * PolicyDecimate). The measurement itself is not removed.
+   */
+  void reduceMeas(const mtMeasPtr& meas, const mtTime& t, typename mtMeasMap::iterator itNext){
+    switch(capacityPolicy_){
+      case PolicyDecimate:
+        if(mergeMeas_){
+          waitForPending(itNext->first);
+          mtMeasPtr merged = makeMeasPtr(*itNext->second); // Might be shared with the caller
+          mergeMeas_(*meas,t,*merged,itNext->first);
+          itNext->second = merged;
+        }
+        countDecimated_++;
+        break;
+      case PolicySpill:
+        if(spillMeas_) spillMeas_(meas,t);
+        countSpilled_++;
+        break;
+      default:
+        countDropped_++;
+    }
+  }
+  mtMeas& getMeas(const mtTime& t){
+    return *measMap_.at(t);
+  }
+  /*!
+   * Single lookup alternative to hasMeasurementAt followed by getMeas, returns nullptr if there is no measurement at t.
+   */
+  mtMeas* findMeas(const mtTime& t){
+    typename mtMeasMap::iterator it = measMap_.find(t);
+    return it != measMap_.end() ? it->second.get() : nullptr;
+  }
+  void clear()
+  {
+    waitForPending();
+    measMap_.clear();
+  }
+  void addPending(const mtTime& t, const std::shared_future<void>& future){
+    pendingMap_[t] = future;
+  }
+  void waitForPending(const mtTime& t){
+    typename std::map<mtTime,std::shared_future<void>>::iterator it = pendingMap_.find(t);
+    if(it != pendingMap_.end()){
+      it->second.wait();
+      pendingMap_.erase(it);
+    }
+  }
+  void waitForPending(){
+    for(auto it = pendingMap_.begin();it != pendingMap_.end();it++){
+      it->second.wait();
+    }
+    pendingMap_.clear();
+  }
+  void clean(mtTime t){
+    while(!pendingMap_.empty() && pendingMap_.begin()->first<=t){
+      pendingMap_.begin()->second.wait();
+      pendingMap_.erase(pendingMap_.begin());
+    }
+    if(measMap_.size() > 1){ // Keep at least the newest measurement
+      measMap_.erase(measMap_.begin(),std::min(measMap_.upper_bound(t),std::prev(measMap_.end())));
+    }
+  }
+  bool getNextTime(mtTime actualTime, mtTime& nextTime){
+    itMeas_ = measMap_.upper_bound(actualTime);
+    if(itMeas_!=measMap_.end()){
+      nextTime = itMeas_->first;
+      return true;
+    } else {
+      return false;
+    }
+  }
+  void waitTime(mtTime actualTime, mtTime& time){
+    mtTime measurementTime = actualTime-TimeTraits<mtTime>::fromSeconds(maxWaitTime_);
+    if(!measMap_.empty() && measMap_.rbegin()->first + TimeTraits<mtTime>::fromSeconds(minWaitTime_) > measurementTime){
+      measurementTime = measMap_.rbegin()->first + TimeTraits<mtTime>::fromSeconds(minWaitTime_);
+    }
+    if(time > measurementTime){
+      time = measurementTime;
+    }
+  }
+  bool getLastTime(mtTime& lastTime){
+    if(!measMap_.empty()){
+      lastTime = measMap_.rbegin()->first;
+      return true;
+    } else {
+      return false;
+    }
+  }
+  /*!
+   * Approximate memory usage in bytes (storage, input queue and the currently held measurements).
+   */
+  size_t memoryFootprint() const{
+    return sizeof(*this) + measMap_.capacity()*sizeof(typename mtMeasMap::value_type) + measMap_.size()*sizeof(mtMeas)
+        + inputQueue_.memoryFootprint() - sizeof(inputQueue_);
+  }
+  bool hasMeasurementAt(mtTime t){
+    return measMap_.count(t)>0;
+  }
+};
+
+}
+
+#endif /* LWF_MEASUREMENTTIMELINE_HPP_ */
@@ -15,6 +15,19 @@
 
 namespace LWF{
 
+/*!
+ * 95% quantile of the chi-square distribution with n degrees of freedom: tabulated up to n = 10, Wilson-Hilferty
+ * approximation above (relative error below 1e-3). Unlike the quadratic fit of OutlierDetectionBase it is valid for the
+ * dimension of large stacked innovations.
+ */
+inline double chiSquareQuantile95(unsigned int n){
+  static const double table[11] = {0.0,3.8415,5.9915,7.8147,9.4877,11.0705,12.5916,14.0671,15.5073,16.9190,18.3070};
+  if(n <= 10) return table[n];
+  const double a = 2.0/(9.0*n);
+  const double c = 1.0-a+1.6448536*std::sqrt(a);
+  return n*c*c*c;
+}
+
 template<unsigned int S, unsigned int D, unsigned int N = 1> struct ODEntry{
   static const unsigned int S_ = S;
   static const unsigned int D_ = D;
@@ -27,6 +40,7 @@ class OutlierDetectionBase{
   static const unsigned int D_ = D;
   bool outlier_;
   bool enabled_;
+  bool preGated_; // Rejected by the pre-gate of Update, check then marks the block as outlier without evaluating it
   double mahalanobisTh_;
   double d_;
   unsigned int outlierCount_;
@@ -34,14 +48,17 @@ class OutlierDetectionBase{
     mahalanobisTh_ = -0.0376136*D_*D_+1.99223*D_+2.05183; // Quadratic fit to chi square
     enabled_ = false;
     outlier_ = false;
+    preGated_ = false;
     outlierCount_ = 0;
     d_ = 0;
   }
   virtual ~OutlierDetectionBase(){};
   template<int E>
-  void check(const Eigen::Matrix<double,E,1>& innVector,const Eigen::MatrixXd& Py){
-    d_ = ((innVector.template block<D_, 1>(S_,0)).transpose()*Py.template block<D_,D_>(S_,S_).inverse()*innVector.template block<D_,1>(S_,0))(0,0);
-    outlier_ = d_ > mahalanobisTh_;
+  void check(const Eigen::Matrix<double,E,1>& innVector,const Eigen::MatrixXd& Py,unsigned int offset = 0){
+    if(!preGated_){
+      d_ = innVector.template block<D_,1>(S_,0).dot(Py.template block<D_,D_>(offset+S_,offset+S_).llt().solve(innVector.template block<D_,1>(S_,0)));
+    }
+    outlier_ = preGated_ || d_ > mahalanobisTh_;
     if(outlier_){
       outlierCount_++;
       VLOG(2) << "Detected outlier - mahalanobis (d / threshold):"  << d_
@@ -56,6 +73,7 @@ class OutlierDetectionBase{
   virtual bool isOutlier(unsigned int i) const = 0;
   virtual void setEnabled(unsigned int i,bool enabled) = 0;
   virtual void setEnabledAll(bool enabled) = 0;
+  virtual bool isEnabledAny() const = 0;
   virtual unsigned int& getCount(unsigned int i) = 0;
   virtual double& getMahalTh(unsigned int i) = 0;
   virtual double getMahalDistance(unsigned int i) const = 0;
@@ -68,6 +86,7 @@ class OutlierDetectionConcat: public OutlierDetectionBase<S,D>{
   using OutlierDetectionBase<S,D>::D_;
   using OutlierDetectionBase<S,D>::outlier_;
   using OutlierDetectionBase<S,D>::enabled_;
+  using OutlierDetectionBase<S,D>::preGated_;
   using OutlierDetectionBase<S,D>::mahalanobisTh_;
   using OutlierDetectionBase<S,D>::outlierCount_;
   using OutlierDetectionBase<S,D>::check;
@@ -75,25 +94,72 @@ class OutlierDetectionConcat: public OutlierDetectionBase<S,D>{
   T sub_;
   OutlierDetectionConcat(){};
   virtual ~OutlierDetectionConcat(){};
+  /*!
+   * Checks the innovation blocks and decouples the outliers. For stacked systems (several innovations of the same type)
+   * offset is the row of the first innovation entry within Py and H.
+   */
   template<int dI>
-  void doOutlierDetection(const Eigen::Matrix<double,dI,1>& innVector,Eigen::MatrixXd& Py,Eigen::MatrixXd& H){
+  void doOutlierDetection(const Eigen::Matrix<double,dI,1>& innVector,Eigen::MatrixXd& Py,Eigen::MatrixXd& H,unsigned int offset = 0){
     static_assert(dI>=S+D,"Outlier detection out of range");
-    check(innVector,Py);
+    check(innVector,Py,offset);
     outlier_ = outlier_ & enabled_;
-    sub_.doOutlierDetection(innVector,Py,H);
+    sub_.doOutlierDetection(innVector,Py,H,offset);
     if(outlier_){
-      Py.block(0,S_,dI,D_).setZero();
-      Py.block(S_,0,D_,dI).setZero();
-      Py.block(S_,S_,D_,D_).setIdentity();
-      H.block(S_,0,D_,H.cols()).setZero();
+      Py.block(0,offset+S_,Py.rows(),D_).setZero();
+      Py.block(offset+S_,0,D_,Py.cols()).setZero();
+      Py.block(offset+S_,offset+S_,D_,D_).setIdentity();
+      H.block(offset+S_,0,D_,H.cols()).setZero();
     }
   }
+  /*!
+   * Same checks as doOutlierDetection, but instead of decoupling the outliers in Py and H their entries are cleared in
+   * the inlier mask (allows to remove them from the system before factorization).
+   */
+  template<int dI>
+  void markOutliers(const Eigen::Matrix<double,dI,1>& innVector,const Eigen::MatrixXd& Py,Eigen::Array<bool,dI,1>& inlierMask,unsigned int offset = 0){
+    static_assert(dI>=S+D,"Outlier detection out of range");
+    check(innVector,Py,offset);
+    outlier_ = outlier_ & enabled_;
+    sub_.markOutliers(innVector,Py,inlierMask,offset);
+    if(outlier_){
+      inlierMask.template segment<D_>(S_).setConstant(false);
+    }
+  }
+  /*!
+   * Coarse check for pre-gating: the distance of each enabled block is approximated with the diagonal pyDiag of the
+   * innovation covariance. Blocks exceeding factor times their threshold are flagged as pre-gated (they are then outliers
+   * of the following checks, see clearPreGating) and their entries are cleared in the mask.
+   */
+  template<int dI>
+  void preGate(const Eigen::Matrix<double,dI,1>& innVector,const Eigen::Matrix<double,dI,1>& pyDiag,double factor,Eigen::Array<bool,dI,1>& preGateMask){
+    static_assert(dI>=S+D,"Outlier detection out of range");
+    preGated_ = false;
+    if(enabled_){
+      d_ = innVector.template block<D_,1>(S_,0).cwiseAbs2().cwiseQuotient(pyDiag.template block<D_,1>(S_,0)).sum();
+      preGated_ = d_ > factor*mahalanobisTh_;
+      if(preGated_) preGateMask.template segment<D_>(S_).setConstant(false);
+    }
+    sub_.preGate(innVector,pyDiag,factor,preGateMask);
+  }
+  /*!
+   * Sets the result of the pre-gate as outcome of the detection (for measurements which are dropped without update).
+   */
+  void applyPreGating(){
+    outlier_ = preGated_;
+    if(outlier_) outlierCount_++;
+    sub_.applyPreGating();
+  }
+  void clearPreGating(){
+    preGated_ = false;
+    sub_.clearPreGating();
+  }
   void registerToPropertyHandler(PropertyHandler* mpPropertyHandler, const std::string& str, unsigned int i = 0){
     mpPropertyHandler->doubleRegister_.registerScalar(str + std::to_string(i), mahalanobisTh_);
     sub_.registerToPropertyHandler(mpPropertyHandler,str,i+1);
   }
   void reset(){
     outlier_ = false;
+    preGated_ = false;
     outlierCount_ = 0;
     sub_.reset();
   }
@@ -115,6 +181,9 @@ class OutlierDetectionConcat: public OutlierDetectionBase<S,D>{
     enabled_ = enabled;
     sub_.setEnabledAll(enabled);
   }
+  bool isEnabledAny() const{
+    return enabled_ || sub_.isEnabledAny();
+  }
   unsigned int& getCount(unsigned int i){
     if(i==0){
       return outlierCount_;
@@ -145,7 +214,17 @@ class OutlierDetectionDefault: public OutlierDetectionBase<0,0>{
   OutlierDetectionDefault(){};
   virtual ~OutlierDetectionDefault(){};
   template<int dI>
-  void doOutlierDetection(const Eigen::Matrix<double,dI,1>& innVector,Eigen::MatrixXd& Py,Eigen::MatrixXd& H){
+  void doOutlierDetection(const Eigen::Matrix<double,dI,1>& innVector,Eigen::MatrixXd& Py,Eigen::MatrixXd& H,unsigned int offset = 0){
+  }
+  template<int dI>
+  void markOutliers(const Eigen::Matrix<double,dI,1>& innVector,const Eigen::MatrixXd& Py,Eigen::Array<bool,dI,1>& inlierMask,unsigned int offset = 0){
+  }
+  template<int dI>
+  void preGate(const Eigen::Matrix<double,dI,1>& innVector,const Eigen::Matrix<double,dI,1>& pyDiag,double factor,Eigen::Array<bool,dI,1>& preGateMask){
+  }
+  void applyPreGating(){
+  }
+  void clearPreGating(){
   }
   void registerToPropertyHandler(PropertyHandler* mpPropertyHandler, const std::string& str, unsigned int i = 0){
   }
@@ -160,6 +239,9 @@ class OutlierDetectionDefault: public OutlierDetectionBase<0,0>{
   }
   void setEnabledAll(bool enabled){
   }
+  bool isEnabledAny() const{
+    return false;
+  }
   unsigned int& getCount(unsigned int i){
     throw std::runtime_error("Outlier index out of range.");
     return outlierCount_;
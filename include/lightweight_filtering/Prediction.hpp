@@ -11,6 +11,7 @@
 #include "lightweight_filtering/common.hpp"
 #include "lightweight_filtering/ModelBase.hpp"
 #include "lightweight_filtering/PropertyHandler.hpp"
+#include "lightweight_filtering/MeasurementTimeline.hpp"
 
 namespace LWF{
 
@@ -24,24 +25,54 @@ class Prediction: public ModelBase<Prediction<FilterState>,typename FilterState:
   typedef typename mtModelBase::mtInputTuple mtInputTuple;
   typedef typename mtFilterState::mtPredictionMeas mtMeas;
   typedef typename mtFilterState::mtPredictionNoise mtNoise;
-  mtMeas meas_;
+  typedef typename mtFilterState::mtTime mtTime;
+  typedef TimeTraits<mtTime> mtTimeTraits;
+  typedef typename MeasurementTimeline<mtMeas,mtTime>::mtMeasMap mtMeasMap;
+  typedef typename mtFilterState::mtPredictionWorkspace mtWorkspace;
+  static const bool canMerge_ = true; // Supports predictMerged
+  const mtMeas* meas_; // Measurement of the ongoing prediction (not owned)
   Eigen::MatrixXd prenoiP_;
   Eigen::MatrixXd prenoiPinv_;
   bool disablePreAndPostProcessingWarning_;
+  bool useIndividualMode_; // Use mode_ instead of the filtering mode of the filter state
+  FilteringMode mode_;
+  mtWorkspace workspace_; // Jacobians and sigma points, filter states only refer to it (see PredictionWorkspace)
+  mtWorkspace horizonWorkspace_; // Workspace of predictHorizon
+  double alpha_;
+  double beta_;
+  double kappa_;
   Prediction(): prenoiP_((int)(mtNoise::D_),(int)(mtNoise::D_)),
                 prenoiPinv_((int)(mtNoise::D_),(int)(mtNoise::D_)){
+    alpha_ = 1e-3;
+    beta_ = 2.0;
+    kappa_ = 0.0;
     prenoiP_.setIdentity();
     prenoiP_ *= 0.0001;
     mtNoise n;
     n.setIdentity();
     n.registerCovarianceToPropertyHandler_(prenoiP_,this,"PredictionNoise.");
     disablePreAndPostProcessingWarning_ = false;
+    meas_ = nullptr;
+    useIndividualMode_ = false;
+    mode_ = ModeEKF;
+    boolRegister_.registerScalar("useIndividualMode",useIndividualMode_);
+    doubleRegister_.registerScalar("alpha",alpha_);
+    doubleRegister_.registerScalar("beta",beta_);
+    doubleRegister_.registerScalar("kappa",kappa_);
     refreshProperties();
   };
   virtual ~Prediction(){};
+  size_t memoryFootprint() const{
+    return sizeof(*this) + heapMemory(prenoiP_,prenoiPinv_) + workspace_.dynamicMemoryFootprint() + horizonWorkspace_.dynamicMemoryFootprint();
+  }
   void refreshProperties(){
     prenoiPinv_.setIdentity();
     prenoiP_.llt().solveInPlace(prenoiPinv_);
+    workspace_.refreshUKFParameter(alpha_,beta_,kappa_);
+    horizonWorkspace_.refreshUKFParameter(alpha_,beta_,kappa_);
+  }
+  FilteringMode getMode(const mtFilterState& filterState) const{
+    return useIndividualMode_ ? mode_ : filterState.mode_;
   }
   void eval_(mtState& x, const mtInputTuple& inputs, double dt) const{
     evalPrediction(x,std::get<0>(inputs),std::get<1>(inputs),dt);
@@ -63,6 +94,11 @@ class Prediction: public ModelBase<Prediction<FilterState>,typename FilterState:
   virtual void jacPreviousState(Eigen::MatrixXd& F, const mtState& previousState, double dt) const = 0;
   virtual void jacNoise(Eigen::MatrixXd& F, const mtState& previousState, double dt) const = 0;
   virtual void noMeasCase(mtFilterState& filterState, mtMeas& meas, double dt){};
+  /*!
+   * Counterpart of noMeasCase for the mean-only prediction (see FilterBase::extrapolate), which has no filter state.
+   * Models which fill the measurement in noMeasCase should fill it here in the same way.
+   */
+  virtual void noMeasCaseMean(const mtState& state, mtMeas& meas, double dt) const{};
   virtual void preProcess(mtFilterState& filterState, const mtMeas& meas, double dt){
     if(!disablePreAndPostProcessingWarning_){
       std::cout << "Warning: prediction preProcessing is not implemented!" << std::endl;
@@ -74,15 +110,19 @@ class Prediction: public ModelBase<Prediction<FilterState>,typename FilterState:
     }
   };
   int performPrediction(mtFilterState& filterState, const mtMeas& meas, double dt){
-    switch(filterState.mode_){
+    return performPrediction(filterState,meas,dt,workspace_);
+  }
+  int performPrediction(mtFilterState& filterState, const mtMeas& meas, double dt, mtWorkspace& workspace){
+    filterState.predictionMode_ = getMode(filterState);
+    switch(filterState.predictionMode_){
       case ModeEKF:
-        return performPredictionEKF(filterState,meas,dt);
+        return performPredictionEKF(filterState,meas,dt,workspace);
       case ModeUKF:
-        return performPredictionUKF(filterState,meas,dt);
+        return performPredictionUKF(filterState,meas,dt,workspace);
       case ModeIEKF:
-        return performPredictionEKF(filterState,meas,dt);
+        return performPredictionEKF(filterState,meas,dt,workspace);
       default:
-        return performPredictionEKF(filterState,meas,dt);
+        return performPredictionEKF(filterState,meas,dt,workspace);
     }
   }
   int performPrediction(mtFilterState& filterState, double dt){
@@ -91,39 +131,107 @@ class Prediction: public ModelBase<Prediction<FilterState>,typename FilterState:
     noMeasCase(filterState,meas,dt);
     return performPrediction(filterState,meas,dt);
   }
-  int performPredictionEKF(mtFilterState& filterState, const mtMeas& meas, double dt){
+  /*!
+   * Mean-only prediction without Jacobians, covariance or pre- and postprocessing (e.g. for high-rate extrapolation).
+   * Sets meas_ for the evaluation like the other predictions and is therefore not thread-safe, it must be called from
+   * the thread which uses the model.
+   */
+  void predictMean(mtState& state, const mtMeas& meas, double dt){
+    PointerGuard<const mtMeas> measGuard(meas_);
+    meas_ = &meas;
+    this->evalPredictionShort(state,state,dt);
+    state.fix();
+  }
+  /*!
+   * If evalJacobians is false, F_ and G_ of the workspace are used as they are (e.g. from a previous step of equal length).
+   */
+  int performPredictionEKF(mtFilterState& filterState, const mtMeas& meas, double dt, bool evalJacobians = true){
+    return performPredictionEKF(filterState,meas,dt,workspace_,evalJacobians);
+  }
+  int performPredictionEKF(mtFilterState& filterState, const mtMeas& meas, double dt, mtWorkspace& workspace, bool evalJacobians = true){
+    PointerGuard<const mtMeas> measGuard(meas_);
     preProcess(filterState,meas,dt);
-    meas_ = meas;
-    this->jacPreviousState(filterState.F_,filterState.state_,dt);
-    this->jacNoise(filterState.G_,filterState.state_,dt);
+    meas_ = &meas;
+    if(evalJacobians){
+      this->jacPreviousState(workspace.F_,filterState.state_,dt);
+      this->jacNoise(workspace.G_,filterState.state_,dt);
+    }
     this->evalPredictionShort(filterState.state_,filterState.state_,dt);
-    filterState.cov_ = filterState.F_*filterState.cov_*filterState.F_.transpose() + filterState.G_*prenoiP_*filterState.G_.transpose();
+    filterState.cov_ = workspace.F_*filterState.cov_*workspace.F_.transpose() + workspace.G_*prenoiP_*workspace.G_.transpose();
+    filterState.predictionWorkspace_ = &workspace;
     filterState.state_.fix();
     enforceSymmetry(filterState.cov_);
-    filterState.t_ += dt;
+    filterState.t_ += mtTimeTraits::fromSeconds(dt);
     postProcess(filterState,meas,dt);
     return 0;
   }
+  /*!
+   * Predicts filterState successively to the increasing times[0..n-1] and stores the state at each of them in states[k]
+   * and the covariance in the columns k*D to (k+1)*D-1 of covs (only resized if its size changes). The measurements of
+   * measMap are used up to the newest one, beyond it the no-measurement case of performPrediction applies. If
+   * reuseJacobians is set, such constant-input steps of equal length reuse F and G of the previous one (EKF only, exact
+   * for linear models). Runs on horizonWorkspace_, the workspace of the regular predictions is left untouched.
+   */
+  int predictHorizon(mtFilterState& filterState, const mtMeasMap& measMap, const mtTime* times, int n, mtState* states, Eigen::MatrixXd& covs, bool reuseJacobians = false){
+    const int D = mtState::D_;
+    if(covs.rows() != D || covs.cols() != n*D){
+      covs.resize(D,n*D);
+    }
+    mtMeas meas;
+    double dtJacobians = -1.0; // Step length of F and G if they belong to the previous constant-input step
+    int r = 0;
+    for(int k=0;k<n;k++){
+      typename mtMeasMap::const_iterator itMeas;
+      while(r == 0 && filterState.t_ < times[k] && (itMeas = measMap.upper_bound(filterState.t_)) != measMap.end()){
+        const mtTime tStep = std::min(itMeas->first,times[k]);
+        r = performPrediction(filterState,*itMeas->second,mtTimeTraits::toSeconds(tStep-filterState.t_),horizonWorkspace_);
+        filterState.t_ = tStep; // The time stamp advanced by the model went through seconds and may be rounded
+        dtJacobians = -1.0;
+      }
+      if(r == 0 && filterState.t_ < times[k]){
+        const double dt = mtTimeTraits::toSeconds(times[k]-filterState.t_);
+        if(reuseJacobians && std::fabs(dt-dtJacobians) <= 1e-9*dt && getMode(filterState) != ModeUKF){
+          r = performPredictionEKF(filterState,meas,dt,horizonWorkspace_,false);
+        } else {
+          meas.setIdentity();
+          noMeasCase(filterState,meas,dt);
+          r = performPrediction(filterState,meas,dt,horizonWorkspace_);
+          dtJacobians = dt;
+        }
+        filterState.t_ = times[k];
+      }
+      if(r != 0) return r;
+      states[k] = filterState.state_;
+      covs.block(0,k*D,D,D) = filterState.cov_;
+    }
+    return 0;
+  }
   int performPredictionUKF(mtFilterState& filterState, const mtMeas& meas, double dt){
-    filterState.refreshNoiseSigmaPoints(prenoiP_);
+    return performPredictionUKF(filterState,meas,dt,workspace_);
+  }
+  int performPredictionUKF(mtFilterState& filterState, const mtMeas& meas, double dt, mtWorkspace& workspace){
+    PointerGuard<const mtMeas> measGuard(meas_);
+    workspace.refreshNoiseSigmaPoints(prenoiP_);
     preProcess(filterState,meas,dt);
-    meas_ = meas;
-    filterState.stateSigmaPoints_.computeFromGaussian(filterState.state_,filterState.cov_);
+    meas_ = &meas;
+    workspace.stateSigmaPoints_.computeFromGaussian(filterState.state_,filterState.cov_);
 
     // Prediction
-    for(unsigned int i=0;i<filterState.stateSigmaPoints_.L_;i++){
-      this->evalPrediction(filterState.stateSigmaPointsPre_(i),filterState.stateSigmaPoints_(i),filterState.stateSigmaPointsNoi_(i),dt);
+    for(unsigned int i=0;i<workspace.stateSigmaPoints_.L_;i++){
+      this->evalPrediction(workspace.stateSigmaPointsPre_(i),workspace.stateSigmaPoints_(i),workspace.stateSigmaPointsNoi_(i),dt);
     }
     // Calculate mean and variance
-    filterState.stateSigmaPointsPre_.getMean(filterState.state_);
-    filterState.stateSigmaPointsPre_.getCovarianceMatrix(filterState.state_,filterState.cov_);
+    workspace.stateSigmaPointsPre_.getMean(filterState.state_);
+    workspace.stateSigmaPointsPre_.getCovarianceMatrix(filterState.state_,filterState.cov_);
+    filterState.predictionWorkspace_ = &workspace;
     filterState.state_.fix();
-    filterState.t_ += dt;
+    filterState.t_ += mtTimeTraits::fromSeconds(dt);
     postProcess(filterState,meas,dt);
     return 0;
   }
-  int predictMerged(mtFilterState& filterState, double tTarget, const std::map<double,mtMeas>& measMap){
-    switch(filterState.mode_){
+  int predictMerged(mtFilterState& filterState, mtTime tTarget, const mtMeasMap& measMap){
+    filterState.predictionMode_ = getMode(filterState);
+    switch(filterState.predictionMode_){
       case ModeEKF:
         return predictMergedEKF(filterState,tTarget,measMap);
       case ModeUKF:
@@ -134,12 +242,13 @@ class Prediction: public ModelBase<Prediction<FilterState>,typename FilterState:
         return predictMergedEKF(filterState,tTarget,measMap);
     }
   }
-  virtual int predictMergedEKF(mtFilterState& filterState, const double tTarget, const std::map<double,mtMeas>& measMap){
-    const typename std::map<double,mtMeas>::const_iterator itMeasStart = measMap.upper_bound(filterState.t_);
+  virtual int predictMergedEKF(mtFilterState& filterState, const mtTime tTarget, const mtMeasMap& measMap){
+    PointerGuard<const mtMeas> measGuard(meas_);
+    const typename mtMeasMap::const_iterator itMeasStart = measMap.upper_bound(filterState.t_);
     if(itMeasStart == measMap.end()) return 0;
-    typename std::map<double,mtMeas>::const_iterator itMeasEnd = measMap.lower_bound(tTarget);
+    typename mtMeasMap::const_iterator itMeasEnd = measMap.lower_bound(tTarget);
     if(itMeasEnd != measMap.end()) ++itMeasEnd;
-    double dT = std::min(std::prev(itMeasEnd)->first,tTarget)-filterState.t_;
+    double dT = mtTimeTraits::toSeconds(std::min(std::prev(itMeasEnd)->first,tTarget)-filterState.t_);
     if(dT <= 0) return 0;
 
     // Compute mean Measurement
@@ -147,63 +256,66 @@ class Prediction: public ModelBase<Prediction<FilterState>,typename FilterState:
     typename mtMeas::mtDifVec vec;
     typename mtMeas::mtDifVec difVec;
     vec.setZero();
-    double t = itMeasStart->first;
-    for(typename std::map<double,mtMeas>::const_iterator itMeas=next(itMeasStart);itMeas!=itMeasEnd;itMeas++){
-      itMeas->second.boxMinus(itMeasStart->second,difVec);
-      vec = vec + difVec*(std::min(itMeas->first,tTarget)-t);
+    mtTime t = itMeasStart->first;
+    for(typename mtMeasMap::const_iterator itMeas=next(itMeasStart);itMeas!=itMeasEnd;itMeas++){
+      itMeas->second->boxMinus(*itMeasStart->second,difVec);
+      vec = vec + difVec*mtTimeTraits::toSeconds(std::min(itMeas->first,tTarget)-t);
       t = std::min(itMeas->first,tTarget);
     }
     vec = vec/dT;
-    itMeasStart->second.boxPlus(vec,meanMeas);
+    itMeasStart->second->boxPlus(vec,meanMeas);
 
     preProcess(filterState,meanMeas,dT);
-    meas_ = meanMeas;
-    this->jacPreviousState(filterState.F_,filterState.state_,dT);
-    this->jacNoise(filterState.G_,filterState.state_,dT); // Works for time continuous parametrization of noise
-    for(typename std::map<double,mtMeas>::const_iterator itMeas=itMeasStart;itMeas!=itMeasEnd;itMeas++){
-      meas_ = itMeas->second;
-      this->evalPredictionShort(filterState.state_,filterState.state_,std::min(itMeas->first,tTarget)-filterState.t_);
+    meas_ = &meanMeas;
+    this->jacPreviousState(workspace_.F_,filterState.state_,dT);
+    this->jacNoise(workspace_.G_,filterState.state_,dT); // Works for time continuous parametrization of noise
+    for(typename mtMeasMap::const_iterator itMeas=itMeasStart;itMeas!=itMeasEnd;itMeas++){
+      meas_ = itMeas->second.get();
+      this->evalPredictionShort(filterState.state_,filterState.state_,mtTimeTraits::toSeconds(std::min(itMeas->first,tTarget)-filterState.t_));
       filterState.t_ = std::min(itMeas->first,tTarget);
     }
-    filterState.cov_ = filterState.F_*filterState.cov_*filterState.F_.transpose() + filterState.G_*prenoiP_*filterState.G_.transpose();
+    filterState.cov_ = workspace_.F_*filterState.cov_*workspace_.F_.transpose() + workspace_.G_*prenoiP_*workspace_.G_.transpose();
+    filterState.predictionWorkspace_ = &workspace_;
     filterState.state_.fix();
     enforceSymmetry(filterState.cov_);
     filterState.t_ = std::min(std::prev(itMeasEnd)->first,tTarget);
     postProcess(filterState,meanMeas,dT);
     return 0;
   }
-  virtual int predictMergedUKF(mtFilterState& filterState, double tTarget, const std::map<double,mtMeas>& measMap){
-    filterState.refreshNoiseSigmaPoints(prenoiP_);
-    const typename std::map<double,mtMeas>::const_iterator itMeasStart = measMap.upper_bound(filterState.t_);
+  virtual int predictMergedUKF(mtFilterState& filterState, mtTime tTarget, const mtMeasMap& measMap){
+    PointerGuard<const mtMeas> measGuard(meas_);
+    workspace_.refreshNoiseSigmaPoints(prenoiP_);
+    const typename mtMeasMap::const_iterator itMeasStart = measMap.upper_bound(filterState.t_);
     if(itMeasStart == measMap.end()) return 0;
-    const typename std::map<double,mtMeas>::const_iterator itMeasEnd = measMap.upper_bound(tTarget);
+    const typename mtMeasMap::const_iterator itMeasEnd = measMap.upper_bound(tTarget);
     if(itMeasEnd == measMap.begin()) return 0;
-    double dT = std::prev(itMeasEnd)->first-filterState.t_;
+    double dT = mtTimeTraits::toSeconds(std::prev(itMeasEnd)->first-filterState.t_);
 
     // Compute mean Measurement
     mtMeas meanMeas;
     typename mtMeas::mtDifVec vec;
     typename mtMeas::mtDifVec difVec;
     vec.setZero();
-    double t = itMeasStart->first;
-    for(typename std::map<double,mtMeas>::const_iterator itMeas=next(itMeasStart);itMeas!=itMeasEnd;itMeas++){
-      itMeasStart->second.boxMinus(itMeas->second,difVec);
-      vec = vec + difVec*(itMeas->first-t);
+    mtTime t = itMeasStart->first;
+    for(typename mtMeasMap::const_iterator itMeas=next(itMeasStart);itMeas!=itMeasEnd;itMeas++){
+      itMeasStart->second->boxMinus(*itMeas->second,difVec);
+      vec = vec + difVec*mtTimeTraits::toSeconds(itMeas->first-t);
       t = itMeas->first;
     }
     vec = vec/dT;
-    itMeasStart->second.boxPlus(vec,meanMeas);
+    itMeasStart->second->boxPlus(vec,meanMeas);
 
     preProcess(filterState,meanMeas,dT);
-    meas_ = meanMeas;
-    filterState.stateSigmaPoints_.computeFromGaussian(filterState.state_,filterState.cov_);
+    meas_ = &meanMeas;
+    workspace_.stateSigmaPoints_.computeFromGaussian(filterState.state_,filterState.cov_);
 
     // Prediction
-    for(unsigned int i=0;i<filterState.stateSigmaPoints_.L_;i++){
-      this->evalPrediction(filterState.stateSigmaPointsPre_(i),filterState.stateSigmaPoints_(i),filterState.stateSigmaPointsNoi_(i),dT);
+    for(unsigned int i=0;i<workspace_.stateSigmaPoints_.L_;i++){
+      this->evalPrediction(workspace_.stateSigmaPointsPre_(i),workspace_.stateSigmaPoints_(i),workspace_.stateSigmaPointsNoi_(i),dT);
     }
-    filterState.stateSigmaPointsPre_.getMean(filterState.state_);
-    filterState.stateSigmaPointsPre_.getCovarianceMatrix(filterState.state_,filterState.cov_);
+    workspace_.stateSigmaPointsPre_.getMean(filterState.state_);
+    workspace_.stateSigmaPointsPre_.getCovarianceMatrix(filterState.state_,filterState.cov_);
+    filterState.predictionWorkspace_ = &workspace_;
     filterState.state_.fix();
     filterState.t_ = std::prev(itMeasEnd)->first;
     postProcess(filterState,meanMeas,dT);
@@ -218,10 +330,11 @@ class Prediction: public ModelBase<Prediction<FilterState>,typename FilterState:
     return testPredictionJacs(state,meas,d,th,dt);
   }
   bool testPredictionJacs(const mtState& state, const mtMeas& meas, double d = 1e-6,double th = 1e-6,double dt = 0.1){
+    PointerGuard<const mtMeas> measGuard(meas_);
     mtInputTuple inputs;
     std::get<0>(inputs) = state;
     std::get<1>(inputs).setIdentity(); // Noise is always set to zero for Jacobians
-    meas_ = meas;
+    meas_ = &meas;
     return this->testJacs(inputs,d,th,dt);
   }
 };
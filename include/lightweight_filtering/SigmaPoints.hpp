@@ -10,6 +10,8 @@
 
 #include "lightweight_filtering/State.hpp"
 #include "lightweight_filtering/common.hpp"
+#include <vector>
+#include <Eigen/StdVector>
 
 namespace LWF{
 
@@ -25,22 +27,30 @@ class SigmaPoints{
   double wc_ = 1.0;
   double wc0_ = 1.0;
   double gamma_ = 1.0;
-  mtState sigmaPoints_[N];
   Eigen::MatrixXd S_;
   SigmaPoints(){
     static_assert(N_+O_<=L_, "Bad dimensions for sigmapoints");
     S_.setZero();
   };
   virtual ~SigmaPoints(){};
+  bool isAllocated() const{
+    return !sigmaPoints_.empty();
+  }
+  void release(){
+    std::vector<mtState,Eigen::aligned_allocator<mtState>>().swap(sigmaPoints_);
+  }
+  size_t dynamicMemoryFootprint() const{
+    return sigmaPoints_.capacity()*sizeof(mtState) + heapMemory(S_);
+  }
   void getMean(mtState& mean) const{
     typename mtState::mtDifVec vec;
     typename mtState::mtDifVec vecTemp;
     vec.setZero();
     for(unsigned int i=1;i<N_;i++){
-      sigmaPoints_[i].boxMinus(sigmaPoints_[0],vecTemp);
+      points()[i].boxMinus(points()[0],vecTemp);
       vec = vec + wm_*vecTemp;
     }
-    sigmaPoints_[0].boxPlus(vec,mean);
+    points()[0].boxPlus(vec,mean);
   };
   void getCovarianceMatrix(Eigen::MatrixXd& C) const{
     mtState mean;
@@ -49,12 +59,12 @@ class SigmaPoints{
   };
   void getCovarianceMatrix(const mtState& mean, Eigen::MatrixXd& C) const{
     typename mtState::mtDifVec vec;
-    sigmaPoints_[0].boxMinus(mean,vec);
+    points()[0].boxMinus(mean,vec);
     Eigen::MatrixXd dynVec;
     dynVec = vec;
     C = dynVec*dynVec.transpose()*(wc0_+ wc_*(L_-N_));
     for(unsigned int i=1;i<N_;i++){
-      sigmaPoints_[i].boxMinus(mean,vec);
+      points()[i].boxMinus(mean,vec);
       dynVec = vec;
       C += dynVec*dynVec.transpose()*wc_;
     }
@@ -106,15 +116,15 @@ class SigmaPoints{
     if(ldltOfP.info()==Eigen::NumericalIssue) std::cout << "Numerical issues while computing Cholesky Matrix" << std::endl;
     S_ = ldltOfP.transpositionsP().transpose()*ldltL*ldltD;
 
-    sigmaPoints_[0].setIdentity();
+    points()[0].setIdentity();
     int otherSize = (N_-2*mtState::D_-1)/2;
     for(unsigned int i=0;i<otherSize;i++){
-      sigmaPoints_[0].boxPlus(C.col(i)*gamma_,sigmaPoints_[i+1]);
-      sigmaPoints_[0].boxPlus(-C.col(i)*gamma_,sigmaPoints_[i+1+otherSize]);
+      points()[0].boxPlus(C.col(i)*gamma_,points()[i+1]);
+      points()[0].boxPlus(-C.col(i)*gamma_,points()[i+1+otherSize]);
     }
     for(unsigned int i=0;i<mtState::D_;i++){
-      sigmaPoints_[0].boxPlus(S_.col(i)*gamma_,sigmaPoints_[2*otherSize+i+1]);
-      sigmaPoints_[0].boxPlus(-S_.col(i)*gamma_,sigmaPoints_[2*otherSize+i+1+mtState::D_]);
+      points()[0].boxPlus(S_.col(i)*gamma_,points()[2*otherSize+i+1]);
+      points()[0].boxPlus(-S_.col(i)*gamma_,points()[2*otherSize+i+1+mtState::D_]);
     }
   };
   void computeFromGaussian(const mtState mean, const Eigen::MatrixXd &P){
@@ -136,10 +146,10 @@ class SigmaPoints{
     if(ldltOfP.info()==Eigen::NumericalIssue) std::cout << "Numerical issues while computing Cholesky Matrix" << std::endl;
     S_ = ldltOfP.transpositionsP().transpose()*ldltL*ldltD;
 
-    sigmaPoints_[0] = mean;
+    points()[0] = mean;
     for(unsigned int i=0;i<mtState::D_;i++){
-      mean.boxPlus(S_.col(i)*gamma_,sigmaPoints_[i+1]);
-      mean.boxPlus(-S_.col(i)*gamma_,sigmaPoints_[i+1+mtState::D_]);
+      mean.boxPlus(S_.col(i)*gamma_,points()[i+1]);
+      mean.boxPlus(-S_.col(i)*gamma_,points()[i+1+mtState::D_]);
     }
   };
   void computeFromGaussian(const mtState mean, const Eigen::MatrixXd &P, const Eigen::MatrixXd &Q){
@@ -162,10 +172,10 @@ class SigmaPoints{
     if(ldltOfP.info()==Eigen::NumericalIssue) std::cout << "Numerical issues while computing Cholesky Matrix" << std::endl;
     S_ = Q*ldltOfP.transpositionsP().transpose()*ldltL*ldltD;
 
-    sigmaPoints_[0] = mean;
+    points()[0] = mean;
     for(unsigned int i=0;i<mtState::D_;i++){
-      mean.boxPlus(S_.col(i)*gamma_,sigmaPoints_[i+1]);
-      mean.boxPlus(-S_.col(i)*gamma_,sigmaPoints_[i+1+mtState::D_]);
+      mean.boxPlus(S_.col(i)*gamma_,points()[i+1]);
+      mean.boxPlus(-S_.col(i)*gamma_,points()[i+1+mtState::D_]);
     }
   };
   void computeFromZeroMeanGaussian(const Eigen::MatrixXd &P){
@@ -176,21 +186,21 @@ class SigmaPoints{
   const mtState& operator()(unsigned int i) const{
     assert(i<L_);
     if(i<O_){
-      return sigmaPoints_[0];
+      return points()[0];
     } else if(i<O_+N_){
-      return sigmaPoints_[i-O_];
+      return points()[i-O_];
     } else {
-      return sigmaPoints_[0];
+      return points()[0];
     }
   };
   mtState& operator()(unsigned int i) {
     assert(i<L_);
     if(i<O_){
-      return sigmaPoints_[0];
+      return points()[0];
     } else if(i<O_+N_){
-      return sigmaPoints_[i-O_];
+      return points()[i-O_];
     } else {
-      return sigmaPoints_[0];
+      return points()[0];
     }
   };
   void computeParameter(double alpha,double beta,double kappa){
@@ -201,6 +211,16 @@ class SigmaPoints{
     wc_ = wm_;
     wc0_ = lambda/(D+lambda)+(1-alpha*alpha+beta);
   };
+ private:
+  /*!
+   * The N states are only allocated on first access, such that unused sigma points (e.g. in EKF mode) are cheap to
+   * hold and to copy.
+   */
+  mtState* points() const{
+    if(sigmaPoints_.empty()) sigmaPoints_.resize(N_);
+    return sigmaPoints_.data();
+  }
+  mutable std::vector<mtState,Eigen::aligned_allocator<mtState>> sigmaPoints_;
 };
 
 }
@@ -0,0 +1,214 @@
+/*
+ * TimeRingBuffer.hpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef LWF_TIMERINGBUFFER_HPP_
+#define LWF_TIMERINGBUFFER_HPP_
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace LWF{
+
+/*!
+ * Time-sorted container with the subset of the std::map<Time,Value> interface used by the measurement timelines.
+ * Entries are stored contiguously in a ring buffer (grows by doubling). Appending in time order and removing from the
+ * front are O(1), out-of-order inserts are located by binary search and shift the younger entries.
+ */
+template<typename Value, typename Time = double>
+class TimeRingBuffer{
+ public:
+  typedef Time key_type;
+  typedef Value mapped_type;
+  typedef std::pair<Time,Value> value_type;
+  typedef size_t size_type;
+
+  template<typename Buffer, typename Entry>
+  class Iterator{
+   public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef typename TimeRingBuffer::value_type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Entry* pointer;
+    typedef Entry& reference;
+    Iterator(): buffer_(nullptr), i_(0){};
+    Iterator(Buffer* buffer, size_type i): buffer_(buffer), i_(i){};
+    template<typename B, typename E>
+    Iterator(const Iterator<B,E>& other): buffer_(other.buffer_), i_(other.i_){}; // iterator -> const_iterator
+    reference operator*() const{ return buffer_->entry(i_); }
+    pointer operator->() const{ return &buffer_->entry(i_); }
+    reference operator[](difference_type n) const{ return buffer_->entry(i_+n); }
+    Iterator& operator++(){ ++i_; return *this; }
+    Iterator operator++(int){ Iterator it(*this); ++i_; return it; }
+    Iterator& operator--(){ --i_; return *this; }
+    Iterator operator--(int){ Iterator it(*this); --i_; return it; }
+    Iterator& operator+=(difference_type n){ i_ += n; return *this; }
+    Iterator& operator-=(difference_type n){ i_ -= n; return *this; }
+    Iterator operator+(difference_type n) const{ return Iterator(buffer_,i_+n); }
+    Iterator operator-(difference_type n) const{ return Iterator(buffer_,i_-n); }
+    difference_type operator-(const Iterator& other) const{ return (difference_type)i_-(difference_type)other.i_; }
+    bool operator==(const Iterator& other) const{ return i_ == other.i_; }
+    bool operator!=(const Iterator& other) const{ return i_ != other.i_; }
+    bool operator<(const Iterator& other) const{ return i_ < other.i_; }
+    bool operator>(const Iterator& other) const{ return i_ > other.i_; }
+    bool operator<=(const Iterator& other) const{ return i_ <= other.i_; }
+    bool operator>=(const Iterator& other) const{ return i_ >= other.i_; }
+    Buffer* buffer_;
+    size_type i_; // Logical index (0 is the oldest entry)
+  };
+  typedef Iterator<TimeRingBuffer,value_type> iterator;
+  typedef Iterator<const TimeRingBuffer,const value_type> const_iterator;
+  typedef std::reverse_iterator<iterator> reverse_iterator;
+  typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+  TimeRingBuffer(size_type capacity = 64): data_(std::max(capacity,(size_type)1)), head_(0), size_(0){};
+  virtual ~TimeRingBuffer(){};
+
+  size_type size() const{ return size_; }
+  bool empty() const{ return size_ == 0; }
+  size_type capacity() const{ return data_.size(); }
+  void reserve(size_type capacity){
+    if(capacity > data_.size()) reallocate(capacity);
+  }
+  void clear(){
+    for(size_type i=0;i<size_;i++){
+      entry(i).second = Value();
+    }
+    head_ = 0;
+    size_ = 0;
+  }
+
+  iterator begin(){ return iterator(this,0); }
+  iterator end(){ return iterator(this,size_); }
+  const_iterator begin() const{ return const_iterator(this,0); }
+  const_iterator end() const{ return const_iterator(this,size_); }
+  reverse_iterator rbegin(){ return reverse_iterator(end()); }
+  reverse_iterator rend(){ return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const{ return const_reverse_iterator(end()); }
+  const_reverse_iterator rend() const{ return const_reverse_iterator(begin()); }
+
+  iterator lower_bound(const Time& t){ return iterator(this,lowerIndex(t)); }
+  const_iterator lower_bound(const Time& t) const{ return const_iterator(this,lowerIndex(t)); }
+  iterator upper_bound(const Time& t){ return iterator(this,upperIndex(t)); }
+  const_iterator upper_bound(const Time& t) const{ return const_iterator(this,upperIndex(t)); }
+  iterator find(const Time& t){
+    const size_type i = lowerIndex(t);
+    return (i < size_ && entry(i).first == t) ? iterator(this,i) : end();
+  }
+  const_iterator find(const Time& t) const{
+    const size_type i = lowerIndex(t);
+    return (i < size_ && entry(i).first == t) ? const_iterator(this,i) : end();
+  }
+  size_type count(const Time& t) const{
+    return find(t) != end() ? 1 : 0;
+  }
+  Value& at(const Time& t){
+    iterator it = find(t);
+    if(it == end()) throw std::out_of_range("TimeRingBuffer::at");
+    return it->second;
+  }
+  const Value& at(const Time& t) const{
+    const_iterator it = find(t);
+    if(it == end()) throw std::out_of_range("TimeRingBuffer::at");
+    return it->second;
+  }
+
+  /*!
+   * Returns the value at time t, inserts a default constructed one if not present.
+   */
+  Value& operator[](const Time& t){
+    if(size_ == 0 || entry(size_-1).first < t){ // Fast path for in-order data
+      if(size_ == data_.size()) reallocate(2*data_.size());
+      value_type& e = entry(size_);
+      e.first = t;
+      e.second = Value();
+      size_++;
+      return e.second;
+    }
+    const size_type i = lowerIndex(t);
+    if(entry(i).first == t) return entry(i).second;
+    if(size_ == data_.size()) reallocate(2*data_.size());
+    size_++;
+    for(size_type j=size_-1;j>i;j--){
+      entry(j) = std::move(entry(j-1));
+    }
+    entry(i).first = t;
+    entry(i).second = Value();
+    return entry(i).second;
+  }
+
+  /*!
+   * Removes the element at it (cheap for the oldest element), returns the iterator to the following element.
+   */
+  iterator erase(iterator it){
+    return erase(it,it+1);
+  }
+  iterator erase(iterator first, iterator last){
+    const size_type n = last-first;
+    if(n == 0) return first;
+    if(first.i_ == 0){ // Bulk removal at the front
+      for(size_type i=0;i<n;i++){
+        entry(i).second = Value();
+      }
+      head_ = (head_+n)%data_.size();
+      size_ -= n;
+      return begin();
+    }
+    for(size_type j=first.i_;j+n<size_;j++){
+      entry(j) = std::move(entry(j+n));
+    }
+    for(size_type j=size_-n;j<size_;j++){
+      entry(j).second = Value();
+    }
+    size_ -= n;
+    return iterator(this,first.i_);
+  }
+  size_type erase(const Time& t){
+    iterator it = find(t);
+    if(it == end()) return 0;
+    erase(it);
+    return 1;
+  }
+
+  value_type& entry(size_type i){ return data_[(head_+i)%data_.size()]; }
+  const value_type& entry(size_type i) const{ return data_[(head_+i)%data_.size()]; }
+
+ private:
+  size_type lowerIndex(const Time& t) const{
+    size_type lo = 0, hi = size_;
+    while(lo < hi){
+      const size_type mid = (lo+hi)/2;
+      if(entry(mid).first < t) lo = mid+1; else hi = mid;
+    }
+    return lo;
+  }
+  size_type upperIndex(const Time& t) const{
+    if(size_ > 0 && entry(size_-1).first <= t) return size_; // Common case: querying the newest time
+    size_type lo = 0, hi = size_;
+    while(lo < hi){
+      const size_type mid = (lo+hi)/2;
+      if(entry(mid).first <= t) lo = mid+1; else hi = mid;
+    }
+    return lo;
+  }
+  void reallocate(size_type capacity){
+    std::vector<value_type> data(capacity);
+    for(size_type i=0;i<size_;i++){
+      data[i] = std::move(entry(i));
+    }
+    data_.swap(data);
+    head_ = 0;
+  }
+  std::vector<value_type> data_;
+  size_type head_;
+  size_type size_;
+};
+
+}
+
+#endif /* LWF_TIMERINGBUFFER_HPP_ */
@@ -0,0 +1,47 @@
+/*
+ * TimeTraits.hpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LWF_TIMETRAITS_HPP_
+#define LWF_TIMETRAITS_HPP_
+
+#include <cmath>
+#include <cstdint>
+
+namespace LWF{
+
+/*!
+ * Conversion between the time stamp type of the filter (FilterState::mtTime) and seconds. Time stamps are only compared
+ * and subtracted, the models always receive time differences in seconds.
+ */
+template<typename Time>
+struct TimeTraits;
+
+template<>
+struct TimeTraits<double>{
+  static double toSeconds(double t){
+    return t;
+  }
+  static double fromSeconds(double s){
+    return s;
+  }
+};
+
+/*!
+ * Integer nanoseconds: exact matching of time stamps and no loss of precision for large (e.g. epoch) time stamps.
+ */
+template<>
+struct TimeTraits<int64_t>{
+  static double toSeconds(int64_t t){
+    return t*1e-9;
+  }
+  static int64_t fromSeconds(double s){
+    return (int64_t)std::llround(s*1e9);
+  }
+};
+
+}
+
+#endif /* LWF_TIMETRAITS_HPP_ */
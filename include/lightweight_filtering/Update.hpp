@@ -33,7 +33,7 @@ class Update: public ModelBase<Update<Innovation,FilterState,Meas,Noise,OutlierD
   typedef Meas mtMeas;
   typedef Noise mtNoise;
   typedef OutlierDetection mtOutlierDetection;
-  mtMeas meas_; // TODO change to pointer, or remove
+  const mtMeas* meas_; // Measurement of the ongoing update (not owned)
   static const bool coupledToPrediction_ = isCoupled;
   bool useSpecialLinearizationPoint_;
   bool useImprovedJacobian_;
@@ -74,7 +74,75 @@ class Update: public ModelBase<Update<Innovation,FilterState,Meas,Noise,OutlierD
   double updateVecNormTermination_;
   int maxNumIteration_;
   int iterationNum_;
+  bool useJacobianFreezing_; // Freeze Jacobians within IEKF iteration once updateVecNorm_ drops below jacobianFreezingTh_
+  double jacobianFreezingTh_;
+  bool useBroydenUpdate_; // Rank-one secant correction of frozen Jacobian
+  bool useAdaptiveTermination_; // Terminate if the estimated remaining correction (from contraction rate) is below updateVecNormTermination_
+  unsigned int jacobianEvaluationCount_;
+  std::vector<unsigned int> iterationHistogram_; // Number of IEKF runs per required number of iterations
+  typename mtInnovation::mtDifVec innVectorLast_;
+  typename mtState::mtDifVec updateVecLast_;
   mtOutlierDetection outlierDetection_;
+  Eigen::MatrixXd batchH_; // Stacked quantities of performUpdateBatch
+  Eigen::MatrixXd batchPy_;
+  Eigen::MatrixXd batchPyx_;
+  Eigen::MatrixXd batchK_;
+  Eigen::VectorXd batchInnVector_;
+  Eigen::Array<bool,Eigen::Dynamic,1> batchInlierMask_; // Rows i*D to (i+1)*D belong to measurement i of the last batch (false if not fused)
+  std::vector<mtOutlierDetection> batchOutlierDetections_; // Outlier detection of the single measurements of the last batch
+  std::vector<unsigned int> batchIndices_;
+  bool useIndividualMode_; // Use mode_ instead of the filtering mode of the filter state (not for coupled updates)
+  FilteringMode mode_;
+  bool useAdaptiveMode_; // Escalate EKF updates to adaptiveEscalationMode_ if the Mahalanobis distance of the inliers exceeds adaptiveModeTh_ (not for coupled updates)
+  FilteringMode adaptiveEscalationMode_;
+  double adaptiveModeTh_;
+  double adaptiveMahalanobisDistance_;
+  typename mtInnovation::mtDifVec adaptiveInnVector_;
+  mtOutlierDetection adaptiveOutlierDetection_; // State of the outlier detection before the check, restored on escalation
+  unsigned int adaptiveEscalationCount_;
+  bool usePreGating_; // Reject outlier blocks before Jacobian evaluation based on the innovation covariance diagonal of the last update
+  double preGatingFactor_; // Factor on the thresholds of the outlier detection blocks
+  double preGatingHitRate_; // Fraction of the pre-gated measurements with at least one rejected block
+  unsigned int preGatingCheckCount_;
+  unsigned int preGatingHitCount_;
+  bool isPreGated_;
+  bool hasPreGatingPyDiag_;
+  typename mtInnovation::mtDifVec preGatingPyDiag_;
+  bool useOutlierCompaction_; // Remove outlier rows from the system instead of decoupling them (EKF only, batches are then processed sequentially)
+  Eigen::Array<bool,mtInnovation::D_,1> inlierMask_;
+  std::vector<int> inlierIndices_;
+  Eigen::MatrixXd compactH_;
+  Eigen::MatrixXd compactPy_;
+  Eigen::MatrixXd compactPyinv_;
+  Eigen::MatrixXd compactK_;
+  Eigen::VectorXd compactInnVector_;
+  bool useQRCompression_; // Compress tall innovations (dimension > state dimension) by QR factorization
+  int compressionBlockSize_; // Size of the diagonal blocks of the noise Hn*R*Hn^T of a single innovation, which must be uncorrelated (see performUpdateEKF)
+  bool isCompressedUpdate_; // The last update was compressed, Py_, Pyinv_ and K_ are then not set (see compH_, compPy_ and compK_)
+  Eigen::MatrixXd compStack_;
+  Eigen::HouseholderQR<Eigen::MatrixXd> compQR_;
+  Eigen::MatrixXd compH_;
+  Eigen::VectorXd compInnVector_;
+  Eigen::MatrixXd compNoise_; // Stacked diagonal blocks of the noise Hn*R*Hn^T
+  Eigen::LLT<Eigen::MatrixXd> compNoiseLLT_;
+  Eigen::MatrixXd compBlock_;
+  Eigen::MatrixXd compPy_;
+  Eigen::MatrixXd compPyx_;
+  Eigen::MatrixXd compK_;
+  bool useNullSpaceProjection_; // Project the update onto the left null space of the nuisance Jacobian (see jacNuisance)
+  Eigen::MatrixXd Hf_;
+  Eigen::ColPivHouseholderQR<Eigen::MatrixXd> nuisanceQR_;
+  Eigen::MatrixXd projStack_;
+  Eigen::MatrixXd projH_;
+  Eigen::MatrixXd projHn_;
+  Eigen::MatrixXd projPy_;
+  Eigen::MatrixXd projPyinv_;
+  Eigen::MatrixXd projK_;
+  Eigen::VectorXd projInnVector_;
+  double nullSpaceOutlierFactor_; // Scales the chi-square threshold of the projected innovation (if outlier detection is enabled)
+  double nullSpaceMahalanobisDistance_;
+  bool isNullSpaceOutlier_;
+  unsigned int nullSpaceOutlierCount_;
   unsigned int numSequences;
   bool disablePreAndPostProcessingWarning_;
   Update(): H_((int)(mtInnovation::D_),(int)(mtState::D_)),
@@ -94,10 +162,38 @@ class Update: public ModelBase<Update<Innovation,FilterState,Meas,Noise,OutlierD
     kappa_ = 0.0;
     updateVecNormTermination_ = 1e-6;
     maxNumIteration_  = 10;
+    useJacobianFreezing_ = false;
+    jacobianFreezingTh_ = 1e-3;
+    useBroydenUpdate_ = false;
+    useAdaptiveTermination_ = false;
+    useNullSpaceProjection_ = false;
+    nullSpaceOutlierFactor_ = 1.0;
+    nullSpaceMahalanobisDistance_ = 0.0;
+    isNullSpaceOutlier_ = false;
+    nullSpaceOutlierCount_ = 0;
+    useQRCompression_ = false;
+    compressionBlockSize_ = 1;
+    isCompressedUpdate_ = false;
+    useOutlierCompaction_ = false;
+    usePreGating_ = false;
+    useIndividualMode_ = false;
+    mode_ = ModeEKF;
+    useAdaptiveMode_ = false;
+    adaptiveEscalationMode_ = ModeIEKF;
+    adaptiveModeTh_ = chiSquareQuantile95(mtInnovation::D_);
+    adaptiveMahalanobisDistance_ = 0.0;
+    adaptiveEscalationCount_ = 0;
+    preGatingFactor_ = 2.0;
+    isPreGated_ = false;
+    hasPreGatingPyDiag_ = false;
+    resetPreGatingStatistics();
+    inlierMask_.setConstant(true);
+    resetIterationStatistics();
     updnoiP_.setIdentity();
     updnoiP_ *= 0.0001;
     noiP_.setZero();
     preupdnoiP_.setZero();
+    meas_ = nullptr;
     useSpecialLinearizationPoint_ = false;
     useImprovedJacobian_ = false;
     yIdentity_.setIdentity();
@@ -112,11 +208,38 @@ class Update: public ModelBase<Update<Innovation,FilterState,Meas,Noise,OutlierD
     doubleRegister_.registerScalar("kappa",kappa_);
     doubleRegister_.registerScalar("updateVecNormTermination",updateVecNormTermination_);
     intRegister_.registerScalar("maxNumIteration",maxNumIteration_);
+    boolRegister_.registerScalar("useJacobianFreezing",useJacobianFreezing_);
+    doubleRegister_.registerScalar("jacobianFreezingTh",jacobianFreezingTh_);
+    boolRegister_.registerScalar("useBroydenUpdate",useBroydenUpdate_);
+    boolRegister_.registerScalar("useAdaptiveTermination",useAdaptiveTermination_);
+    boolRegister_.registerScalar("useNullSpaceProjection",useNullSpaceProjection_);
+    doubleRegister_.registerScalar("nullSpaceOutlierFactor",nullSpaceOutlierFactor_);
+    boolRegister_.registerScalar("useQRCompression",useQRCompression_);
+    intRegister_.registerScalar("compressionBlockSize",compressionBlockSize_);
+    boolRegister_.registerScalar("useOutlierCompaction",useOutlierCompaction_);
+    boolRegister_.registerScalar("useIndividualMode",useIndividualMode_);
+    boolRegister_.registerScalar("useAdaptiveMode",useAdaptiveMode_);
+    doubleRegister_.registerScalar("adaptiveModeTh",adaptiveModeTh_);
+    boolRegister_.registerScalar("usePreGating",usePreGating_);
+    doubleRegister_.registerScalar("preGatingFactor",preGatingFactor_);
     outlierDetection_.setEnabledAll(false);
     numSequences = 1;
     disablePreAndPostProcessingWarning_ = false;
   };
   virtual ~Update(){};
+  /*!
+   * Approximate memory usage in bytes, the sigma points only count once they were used (UKF mode).
+   */
+  size_t memoryFootprint() const{
+    return sizeof(*this) + heapMemory(H_,Hlin_,boxMinusJac_,Hn_,updnoiP_,noiP_,preupdnoiP_,C_,Py_,Pyinv_,K_,Pyx_)
+        + heapMemory(batchH_,batchPy_,batchPyx_,batchK_,batchInnVector_,batchInlierMask_,compactH_,compactPy_,compactPyinv_,compactK_,compactInnVector_)
+        + batchOutlierDetections_.capacity()*sizeof(mtOutlierDetection)
+        + heapMemory(compStack_,compH_,compInnVector_,compNoise_,compBlock_,compPy_,compPyx_,compK_)
+        + heapMemory(Hf_,projStack_,projH_,projHn_,projPy_,projPyinv_,projK_,projInnVector_)
+        + stateSigmaPoints_.dynamicMemoryFootprint() + stateSigmaPointsNoi_.dynamicMemoryFootprint()
+        + innSigmaPoints_.dynamicMemoryFootprint() + coupledStateSigmaPointsNoi_.dynamicMemoryFootprint()
+        + coupledInnSigmaPoints_.dynamicMemoryFootprint() + updateVecSP_.dynamicMemoryFootprint() + posterior_.dynamicMemoryFootprint();
+  }
   void refreshNoiseSigmaPoints(){
     if(noiP_ != updnoiP_){
       noiP_ = updnoiP_;
@@ -138,6 +261,59 @@ class Update: public ModelBase<Update<Innovation,FilterState,Meas,Noise,OutlierD
     refreshUKFParameter();
   }
   virtual void refreshPropertiesCustom(){}
+  void resetIterationStatistics(){
+    jacobianEvaluationCount_ = 0;
+    iterationHistogram_.clear();
+  }
+  /*!
+   * Coupled updates always run in the mode of the preceding prediction, since they rely on its workspace.
+   */
+  FilteringMode getMode(const mtFilterState& filterState) const{
+    if(isCoupled) return filterState.predictionMode_;
+    return useIndividualMode_ ? mode_ : filterState.mode_;
+  }
+  void resetPreGatingStatistics(){
+    preGatingCheckCount_ = 0;
+    preGatingHitCount_ = 0;
+    preGatingHitRate_ = 0.0;
+  }
+  void cachePreGatingPyDiag(){
+    preGatingPyDiag_ = Py_.diagonal();
+    hasPreGatingPyDiag_ = true;
+  }
+  /*!
+   * Evaluates the innovation only and approximates the Mahalanobis distances of the outlier detection blocks with the
+   * diagonal of the innovation covariance of the last update. Enabled blocks exceeding preGatingFactor_ times their
+   * threshold are flagged in outlierDetection_, the following update treats them as outliers without evaluating them.
+   * Returns true if the measurement should be dropped, i.e. if no innovation row is left (or if any block is rejected in
+   * null-space mode, where the projected rows cannot be separated), its blocks are then marked as outliers. Not applied
+   * with a special linearization point, where the innovation at the current state is not the one of the update.
+   */
+  bool preGate(const mtFilterState& filterState, const mtMeas& meas){
+    PointerGuard<const mtMeas> measGuard(meas_);
+    isPreGated_ = false;
+    outlierDetection_.clearPreGating();
+    if(!hasPreGatingPyDiag_ || useSpecialLinearizationPoint_) return false;
+    meas_ = &meas;
+    this->evalInnovationShort(y_,filterState.state_);
+    y_.boxMinus(yIdentity_,innVector_);
+    preGatingCheckCount_++;
+    inlierMask_.setConstant(true);
+    outlierDetection_.preGate(innVector_,preGatingPyDiag_,preGatingFactor_,inlierMask_);
+    if(!inlierMask_.all()){
+      preGatingHitCount_++;
+      if(!inlierMask_.any() || useNullSpaceProjection_){
+        isPreGated_ = true;
+        outlierDetection_.applyPreGating();
+      }
+    }
+    preGatingHitRate_ = (double)preGatingHitCount_/preGatingCheckCount_;
+    return isPreGated_;
+  }
+  void recordIterationNum(unsigned int n){
+    if(iterationHistogram_.size() <= n) iterationHistogram_.resize(n+1,0);
+    iterationHistogram_[n]++;
+  }
   void eval_(mtInnovation& x, const mtInputTuple& inputs, double dt) const{
     evalInnovation(x,std::get<0>(inputs),std::get<1>(inputs));
   }
@@ -157,12 +333,25 @@ class Update: public ModelBase<Update<Innovation,FilterState,Meas,Noise,OutlierD
   }
   virtual void jacState(Eigen::MatrixXd& F, const mtState& state) const = 0;
   virtual void jacNoise(Eigen::MatrixXd& F, const mtState& state) const = 0;
+  /*!
+   * Jacobian of the innovation w.r.t. nuisance parameters which are not part of the state (e.g. landmark positions of
+   * multi-view constraints). Only used if useNullSpaceProjection_ is set. Default: no nuisance parameters.
+   */
+  virtual void jacNuisance(Eigen::MatrixXd& F, const mtState& state) const{
+    F.resize(mtInnovation::D_,0);
+  }
   virtual void preProcess(mtFilterState& filterState, const mtMeas& meas, bool& isFinished){
     isFinished = false;
     if(!disablePreAndPostProcessingWarning_){
       std::cout << "Warning: update preProcessing is not implemented!" << std::endl;
     }
   }
+  /*!
+   * State-independent (expensive) part of the preprocessing. Called on a worker thread if FilterBase::useAsyncPreProcessing_
+   * is set, with the latest available filter state as prior. Must be thread-safe.
+   */
+  virtual void preProcessMeas(mtMeas& meas, const mtFilterState& prior) const{
+  }
   virtual bool extraOutlierCheck(const mtState& state) const{
     return hasConverged_;
   }
@@ -185,8 +374,16 @@ class Update: public ModelBase<Update<Innovation,FilterState,Meas,Noise,OutlierD
     int r = 0;
     do {
       preProcess(filterState,meas,isFinished);
-      if(!isFinished){
-        switch(filterState.mode_){
+      isCompressedUpdate_ = false;
+      if(!isFinished && usePreGating_ && preGate(filterState,meas)){
+        // Measurement rejected by pre-gating, its blocks are marked as outliers
+      } else if(!isFinished && useNullSpaceProjection_){
+        r = performUpdateNullSpace(filterState,meas);
+      } else if(!isFinished){
+        if(useOutlierCompaction_ && getMode(filterState) != ModeEKF){
+          std::cout << "Warning: outlier compaction is only implemented for EKF updates!" << std::endl;
+        }
+        switch(getMode(filterState)){
           case ModeEKF:
             r = performUpdateEKF(filterState,meas);
             break;
@@ -201,14 +398,270 @@ class Update: public ModelBase<Update<Innovation,FilterState,Meas,Noise,OutlierD
             break;
         }
       }
+      outlierDetection_.clearPreGating();
       postProcess(filterState,meas,outlierDetection_,isFinished);
       filterState.state_.fix();
       enforceSymmetry(filterState.cov_);
     } while (!isFinished);
     return r;
   }
+  /*!
+   * Fuses n measurements of this update type which refer to the same time instant. In EKF mode all innovations are
+   * linearized at the current state, stacked and processed with a single covariance update (equivalent to sequential
+   * updates for linear models). The outlier detection is evaluated per measurement, its results are available in
+   * batchOutlierDetections_ and (stacked update only) batchInlierMask_, the outlier counts evolve as for sequential updates. preProcess is
+   * called for all measurements before and postProcess after the stacked update; measurements whose postprocessing
+   * is not finished continue with performUpdate. Other modes and configurations which the stacked update does not
+   * support (special linearization point, null-space projection, pre-gating, adaptive mode, outlier compaction) fall
+   * back to performUpdate.
+   */
+  int performUpdateBatch(mtFilterState& filterState, const mtMeas* meas, unsigned int n){
+    int r = 0;
+    if(n == 0) return r;
+    if(getMode(filterState) != ModeEKF || n == 1 || useSpecialLinearizationPoint_ || useNullSpaceProjection_ || usePreGating_ || useAdaptiveMode_ || useOutlierCompaction_){
+      batchInlierMask_.resize(0);
+      batchOutlierDetections_.resize(n);
+      for(unsigned int i=0;i<n;i++){
+        r = performUpdate(filterState,meas[i]);
+        batchOutlierDetections_[i] = outlierDetection_;
+      }
+      return r;
+    }
+    bool isFinished = true;
+    batchIndices_.clear();
+    for(unsigned int i=0;i<n;i++){
+      preProcess(filterState,meas[i],isFinished);
+      if(!isFinished) batchIndices_.push_back(i);
+    }
+    r = performUpdateBatchEKF(filterState,meas,n);
+    filterState.state_.fix();
+    enforceSymmetry(filterState.cov_);
+    for(unsigned int i=0;i<n;i++){
+      postProcess(filterState,meas[i],batchOutlierDetections_[i],isFinished);
+      filterState.state_.fix();
+      enforceSymmetry(filterState.cov_);
+      if(!isFinished) r = performUpdate(filterState,meas[i]);
+    }
+    return r;
+  }
+  int performUpdateBatch(mtFilterState& filterState, const std::vector<mtMeas,Eigen::aligned_allocator<mtMeas>>& meas){
+    return performUpdateBatch(filterState,meas.data(),meas.size());
+  }
+  /*!
+   * Evaluates H_, Hn_ and innVector_ at the given state (used for stacking several innovations into one update).
+   */
+  void linearizeInnovation(const mtState& state, const mtMeas& meas){
+    PointerGuard<const mtMeas> measGuard(meas_);
+    meas_ = &meas;
+    this->jacState(H_,state);
+    this->jacNoise(Hn_,state);
+    this->evalInnovationShort(y_,state);
+    y_.boxMinus(yIdentity_,innVector_);
+  }
+  /*!
+   * Stacked EKF update of the measurements in batchIndices_ (see performUpdateBatch).
+   */
+  int performUpdateBatchEKF(mtFilterState& filterState, const mtMeas* meas, unsigned int n){
+    static_assert(!isCoupled,"Batch update is not supported for coupled updates");
+    const int dI = mtInnovation::D_;
+    const int nActive = batchIndices_.size();
+    const int m = nActive*dI;
+    batchInlierMask_.setConstant(n*dI,false);
+    batchOutlierDetections_.assign(n,outlierDetection_);
+    isCompressedUpdate_ = false;
+    if(nActive == 0) return 0;
+    batchH_.resize(m,mtState::D_);
+    batchInnVector_.resize(m);
+    if(isCompressionApplicable(m)){
+      compNoise_.resize(m,dI);
+      for(int k=0;k<nActive;k++){
+        linearizeInnovation(filterState.state_,meas[batchIndices_[k]]);
+        batchH_.block(k*dI,0,dI,mtState::D_) = H_;
+        compNoise_.middleRows(k*dI,dI).noalias() = Hn_*updnoiP_*Hn_.transpose();
+        batchInnVector_.segment(k*dI,dI) = innVector_;
+      }
+      if(performCompressedUpdate(filterState,batchH_,compNoise_,dI,batchInnVector_)){
+        for(int k=0;k<nActive;k++){
+          batchInlierMask_.segment(batchIndices_[k]*dI,dI).setConstant(true);
+        }
+        isCompressedUpdate_ = true;
+        return 0;
+      }
+    }
+    batchPy_.setZero(m,m);
+    for(int k=0;k<nActive;k++){
+      linearizeInnovation(filterState.state_,meas[batchIndices_[k]]);
+      batchH_.block(k*dI,0,dI,mtState::D_) = H_;
+      batchPy_.block(k*dI,k*dI,dI,dI) = Hn_*updnoiP_*Hn_.transpose();
+      batchInnVector_.segment(k*dI,dI) = innVector_;
+    }
+    batchPyx_.noalias() = batchH_*filterState.cov_;
+    batchPy_.noalias() += batchPyx_*batchH_.transpose();
+
+    // Outlier detection, each measurement is gated on its own diagonal block (the counts are passed on as for sequential updates)
+    for(int k=0;k<nActive;k++){
+      const unsigned int i = batchIndices_[k];
+      batchOutlierDetections_[i] = outlierDetection_;
+      innVector_ = batchInnVector_.segment(k*dI,dI);
+      inlierMask_.setConstant(true);
+      batchOutlierDetections_[i].markOutliers(innVector_,batchPy_,inlierMask_,k*dI);
+      outlierDetection_ = batchOutlierDetections_[i];
+      batchInlierMask_.segment(i*dI,dI) = inlierMask_;
+      for(int j=0;j<dI;j++){
+        if(!inlierMask_(j)){
+          batchPy_.row(k*dI+j).setZero();
+          batchPy_.col(k*dI+j).setZero();
+          batchPy_(k*dI+j,k*dI+j) = 1.0;
+          batchH_.row(k*dI+j).setZero();
+        }
+      }
+    }
+    batchPyx_.noalias() = batchH_*filterState.cov_;
+
+    // Kalman Update, K = P*H^T*Py^-1 is obtained from a single Cholesky solve
+    batchK_ = batchPy_.llt().solve(batchPyx_).transpose();
+    filterState.cov_.noalias() -= batchK_*batchPyx_;
+    updateVec_ = -batchK_*batchInnVector_;
+    filterState.state_.boxPlus(updateVec_,filterState.state_);
+    return 0;
+  }
+  /*!
+   * Left-multiplies H_, Hn_ and innVector_ with the orthogonal complement of the column space of the nuisance Jacobian.
+   * The projected system (projH_, projHn_, projInnVector_) is independent of the nuisance parameters.
+   */
+  void projectOnNuisanceNullSpace(const mtState& state){
+    this->jacNuisance(Hf_,state);
+    int r = 0;
+    if(Hf_.cols() > 0){
+      nuisanceQR_.compute(Hf_);
+      r = nuisanceQR_.rank();
+    }
+    const int m = mtInnovation::D_-r;
+    projStack_.resize(mtInnovation::D_,mtState::D_+mtNoise::D_+1);
+    projStack_ << H_, Hn_, innVector_;
+    if(r > 0){
+      projStack_ = nuisanceQR_.householderQ().transpose()*projStack_;
+    }
+    projH_ = projStack_.block(r,0,m,mtState::D_);
+    projHn_ = projStack_.block(r,mtState::D_,m,mtNoise::D_);
+    projInnVector_ = projStack_.block(r,mtState::D_+mtNoise::D_,m,1);
+  }
+  /*!
+   * Update on the null space projected innovation. Iterates in ModeIEKF, otherwise performs a single EKF step (ModeUKF
+   * is not supported and falls back to the EKF step with a warning). Since the projected rows do not correspond to the
+   * blocks of the outlier detection, the whole projected innovation is gated instead if any block is enabled: the
+   * measurement is dropped if its Mahalanobis distance at the prior exceeds nullSpaceOutlierFactor_ times the 95% chi-square
+   * quantile of the projected dimension (see chiSquareQuantile95).
+   */
+  int performUpdateNullSpace(mtFilterState& filterState, const mtMeas& meas){
+    PointerGuard<const mtMeas> measGuard(meas_);
+    meas_ = &meas;
+    if(getMode(filterState) == ModeUKF){
+      std::cout << "Warning: null-space projection does not support UKF updates, performing an EKF update!" << std::endl;
+    }
+    const int numIteration = getMode(filterState) == ModeIEKF ? maxNumIteration_ : 1;
+    linState_ = filterState.state_;
+    hasConverged_ = false;
+    isNullSpaceOutlier_ = false;
+    for(iterationNum_=0;iterationNum_<numIteration && !hasConverged_;iterationNum_++){
+      this->jacState(H_,linState_);
+      this->jacNoise(Hn_,linState_);
+      this->evalInnovationShort(y_,linState_);
+      y_.boxMinus(yIdentity_,innVector_);
+      projectOnNuisanceNullSpace(linState_);
+      if(projInnVector_.size() == 0) return 0; // Fully absorbed by nuisance parameters
+      if(isCoupled){
+        C_ = getPredictionWorkspace(filterState).G_*preupdnoiP_*projHn_.transpose();
+        projPy_ = projH_*filterState.cov_*projH_.transpose() + projHn_*updnoiP_*projHn_.transpose() + projH_*C_ + C_.transpose()*projH_.transpose();
+      } else {
+        projPy_ = projH_*filterState.cov_*projH_.transpose() + projHn_*updnoiP_*projHn_.transpose();
+      }
+      projPyinv_.setIdentity(projPy_.rows(),projPy_.cols());
+      projPy_.llt().solveInPlace(projPyinv_);
+      if(iterationNum_ == 0 && outlierDetection_.isEnabledAny()){
+        nullSpaceMahalanobisDistance_ = projInnVector_.dot(projPyinv_*projInnVector_);
+        if(nullSpaceMahalanobisDistance_ > nullSpaceOutlierFactor_*chiSquareQuantile95(projInnVector_.size())){
+          isNullSpaceOutlier_ = true;
+          nullSpaceOutlierCount_++;
+          return 0;
+        }
+      }
+      if(isCoupled){
+        projK_ = (filterState.cov_*projH_.transpose()+C_)*projPyinv_;
+      } else {
+        projK_ = filterState.cov_*projH_.transpose()*projPyinv_;
+      }
+      filterState.state_.boxMinus(linState_,difVecLinInv_);
+      updateVec_ = -projK_*(projInnVector_+projH_*difVecLinInv_)+difVecLinInv_;
+      linState_.boxPlus(updateVec_,linState_);
+      updateVecNorm_ = updateVec_.norm();
+      hasConverged_ = updateVecNorm_<=updateVecNormTermination_;
+    }
+    filterState.cov_ = filterState.cov_ - projK_*projPy_*projK_.transpose();
+    filterState.state_ = linState_;
+    return 0;
+  }
+  bool isCompressionApplicable(int m) const{
+    return useQRCompression_ && !isCoupled && m > (int)mtState::D_ && !outlierDetection_.isEnabledAny();
+  }
+  /*!
+   * EKF update of a tall system (m > D). The system [H | inn] is whitened with the Cholesky factors of the block diagonal
+   * noise covariance (noiseBlocks stacks its blockSize x blockSize blocks Hn*R*Hn^T, the last one may be smaller),
+   * QR-factorized and replaced by its first D rows, such that the cost of the update scales with the state dimension
+   * instead of the innovation dimension. The result is equivalent to the full update. Returns false without changing
+   * filterState if a block is singular.
+   */
+  template<typename Derived>
+  bool performCompressedUpdate(mtFilterState& filterState, const Eigen::MatrixXd& H, const Eigen::MatrixXd& noiseBlocks, int blockSize, const Eigen::MatrixBase<Derived>& inn){
+    const int m = H.rows();
+    compStack_.resize(m,mtState::D_+1);
+    compStack_.leftCols(mtState::D_) = H;
+    compStack_.col(mtState::D_) = inn;
+    for(int i=0;i<m;i+=blockSize){
+      const int b = std::min(blockSize,m-i);
+      compNoiseLLT_.compute(noiseBlocks.block(i,0,b,b));
+      if(compNoiseLLT_.info() != Eigen::Success) return false;
+      compBlock_ = compStack_.middleRows(i,b);
+      compNoiseLLT_.matrixL().solveInPlace(compBlock_);
+      compStack_.middleRows(i,b) = compBlock_;
+    }
+    compQR_.compute(compStack_);
+    compH_ = compQR_.matrixQR().topLeftCorner(mtState::D_,mtState::D_).template triangularView<Eigen::Upper>();
+    compInnVector_ = compQR_.matrixQR().block(0,mtState::D_,mtState::D_,1);
+    compPyx_.noalias() = compH_*filterState.cov_;
+    compPy_.setIdentity(mtState::D_,mtState::D_);
+    compPy_.noalias() += compPyx_*compH_.transpose();
+    compK_ = compPy_.llt().solve(compPyx_).transpose();
+    filterState.cov_.noalias() -= compK_*compPyx_;
+    updateVec_ = -compK_*compInnVector_;
+    filterState.state_.boxPlus(updateVec_,filterState.state_);
+    return true;
+  }
+  /*!
+   * Tall innovations are compressed if useQRCompression_ is set (see isCompressionApplicable). Only the diagonal blocks of
+   * size compressionBlockSize_ of the noise Hn*R*Hn^T are then used (1 for pre-whitened or isotropic noise, the innovation
+   * dimension for arbitrary noise at O(m^3) cost). The full m x m system is not formed: Py_, Pyinv_ and K_ are left
+   * untouched and isCompressedUpdate_ is set, postProcess can use compH_, compPy_ and compK_ of the compressed system instead.
+   */
   int performUpdateEKF(mtFilterState& filterState, const mtMeas& meas){
-    meas_ = meas;
+    PointerGuard<const mtMeas> measGuard(meas_);
+    meas_ = &meas;
+    isCompressedUpdate_ = false;
+    if(!useSpecialLinearizationPoint_ && isCompressionApplicable(mtInnovation::D_)){
+      linearizeInnovation(filterState.state_,meas);
+      const int m = mtInnovation::D_;
+      const int blockSize = std::max(1,std::min(compressionBlockSize_,m));
+      compNoise_.resize(m,blockSize);
+      for(int i=0;i<m;i+=blockSize){
+        const int b = std::min(blockSize,m-i);
+        compNoise_.block(i,0,b,b).noalias() = Hn_.middleRows(i,b)*updnoiP_*Hn_.middleRows(i,b).transpose();
+      }
+      if(performCompressedUpdate(filterState,H_,compNoise_,blockSize,innVector_)){
+        Hlin_ = H_;
+        isCompressedUpdate_ = true;
+        return 0;
+      }
+    }
     if(!useSpecialLinearizationPoint_){
       this->jacState(H_,filterState.state_);
       Hlin_ = H_;
@@ -228,17 +681,49 @@ class Update: public ModelBase<Update<Innovation,FilterState,Meas,Noise,OutlierD
     }
 
     if(isCoupled){
-      C_ = filterState.G_*preupdnoiP_*Hn_.transpose();
+      C_ = getPredictionWorkspace(filterState).G_*preupdnoiP_*Hn_.transpose();
       Py_ = Hlin_*filterState.cov_*Hlin_.transpose() + Hn_*updnoiP_*Hn_.transpose() + Hlin_*C_ + C_.transpose()*Hlin_.transpose();
     } else {
       Py_ = Hlin_*filterState.cov_*Hlin_.transpose() + Hn_*updnoiP_*Hn_.transpose();
     }
     y_.boxMinus(yIdentity_,innVector_);
+    if(usePreGating_) cachePreGatingPyDiag();
 
     // Outlier detection // TODO: adapt for special linearization point
-    outlierDetection_.doOutlierDetection(innVector_,Py_,Hlin_);
-    Pyinv_.setIdentity();
-    Py_.llt().solveInPlace(Pyinv_);
+    const bool checkEscalation = !isCoupled && useAdaptiveMode_ && adaptiveEscalationMode_ != ModeEKF;
+    if(checkEscalation) adaptiveOutlierDetection_ = outlierDetection_;
+    inlierMask_.setConstant(true);
+    outlierDetection_.markOutliers(innVector_,Py_,inlierMask_);
+    if(!inlierMask_.all()){
+      decoupleOutliers();
+    }
+
+    // Py_ is factorized once, the inverse serves the escalation check and the (compacted) Kalman update
+    const bool useCompaction = useOutlierCompaction_ && !inlierMask_.all();
+    const bool hasPyinv = checkEscalation || !useCompaction;
+    if(hasPyinv){
+      Pyinv_.setIdentity();
+      Py_.llt().solveInPlace(Pyinv_);
+    }
+
+    // Adaptive escalation to a more expensive mode for strongly deviating innovations, rejected blocks do not count
+    if(checkEscalation){
+      adaptiveInnVector_ = inlierMask_.select(innVector_.array(),0.0).matrix();
+      adaptiveMahalanobisDistance_ = adaptiveInnVector_.dot(Pyinv_*adaptiveInnVector_);
+      if(adaptiveMahalanobisDistance_ > adaptiveModeTh_){
+        adaptiveEscalationCount_++;
+        outlierDetection_ = adaptiveOutlierDetection_; // The escalated update performs its own outlier detection
+        if(adaptiveEscalationMode_ == ModeUKF){
+          return performUpdateUKF(filterState,meas);
+        } else {
+          return performUpdateIEKF(filterState,meas);
+        }
+      }
+    }
+    if(useCompaction){
+      performCompactedUpdateEKF(filterState,hasPyinv);
+      return 0;
+    }
 
     // Kalman Update
     if(isCoupled){
@@ -256,8 +741,83 @@ class Update: public ModelBase<Update<Innovation,FilterState,Meas,Noise,OutlierD
     filterState.state_.boxPlus(updateVec_,filterState.state_);
     return 0;
   }
+  /*!
+   * Decouples the rows marked as outliers in inlierMask_ from Py_ and Hlin_ (same as OutlierDetection::doOutlierDetection).
+   */
+  void decoupleOutliers(){
+    for(unsigned int i=0;i<mtInnovation::D_;i++){
+      if(!inlierMask_(i)){
+        Py_.row(i).setZero();
+        Py_.col(i).setZero();
+        Py_(i,i) = 1.0;
+        Hlin_.row(i).setZero();
+      }
+    }
+  }
+  /*!
+   * Kalman update restricted to the inlier rows (inlierMask_). Afterwards Py_, Hlin_, Pyinv_ and K_ are set as if the
+   * outliers had been decoupled, such that they remain consistent for postprocessing. If hasPyinv is set, Pyinv_ already
+   * holds the inverse of the decoupled Py_ and its inlier block is used instead of factorizing again.
+   */
+  void performCompactedUpdateEKF(mtFilterState& filterState, bool hasPyinv = false){
+    inlierIndices_.clear();
+    for(unsigned int i=0;i<mtInnovation::D_;i++){
+      if(inlierMask_(i)) inlierIndices_.push_back(i);
+    }
+    const int n = inlierIndices_.size();
+    if(useSpecialLinearizationPoint_){
+      filterState.state_.boxMinus(linState_,difVecLinInv_);
+    }
+    compactH_.resize(n,mtState::D_);
+    compactPy_.resize(n,n);
+    compactInnVector_.resize(n);
+    for(int j=0;j<n;j++){
+      compactH_.row(j) = Hlin_.row(inlierIndices_[j]);
+      compactInnVector_(j) = innVector_(inlierIndices_[j]);
+      if(useSpecialLinearizationPoint_){
+        compactInnVector_(j) += (H_.row(inlierIndices_[j])*difVecLinInv_)(0); // includes correction for offseted linearization point
+      }
+      for(int k=0;k<n;k++){
+        compactPy_(j,k) = Py_(inlierIndices_[j],inlierIndices_[k]);
+      }
+    }
+    if(hasPyinv){
+      compactPyinv_.resize(n,n);
+      for(int j=0;j<n;j++){
+        for(int k=0;k<n;k++){
+          compactPyinv_(j,k) = Pyinv_(inlierIndices_[j],inlierIndices_[k]);
+        }
+      }
+    } else {
+      compactPyinv_.setIdentity(n,n);
+      compactPy_.llt().solveInPlace(compactPyinv_);
+    }
+    if(isCoupled){
+      compactK_ = filterState.cov_*compactH_.transpose();
+      for(int j=0;j<n;j++){
+        compactK_.col(j) += C_.col(inlierIndices_[j]);
+      }
+      compactK_ = compactK_*compactPyinv_;
+    } else {
+      compactK_ = filterState.cov_*compactH_.transpose()*compactPyinv_;
+    }
+    filterState.cov_ = filterState.cov_ - compactK_*compactPy_*compactK_.transpose();
+    updateVec_ = -compactK_*compactInnVector_;
+    filterState.state_.boxPlus(updateVec_,filterState.state_);
+
+    // Scatter back (Py_ and Hlin_ are already decoupled)
+    K_.setZero();
+    Pyinv_.setIdentity();
+    for(int j=0;j<n;j++){
+      K_.col(inlierIndices_[j]) = compactK_.col(j);
+      for(int k=0;k<n;k++){
+        Pyinv_(inlierIndices_[j],inlierIndices_[k]) = compactPyinv_(j,k);
+      }
+    }
+  }
   int performUpdateIEKF(mtFilterState& filterState, const mtMeas& meas){
-    meas_ = meas;
+    PointerGuard<const mtMeas> measGuard(meas_);
+    meas_ = &meas;
     successfulUpdate_ = false;
     candidateCounter_ = 0;
 
@@ -270,36 +830,60 @@ class Update: public ModelBase<Update<Innovation,FilterState,Meas,Noise,OutlierD
     while(generateCandidates(filterState,linState_)){
       cancelIteration_ = false;
       hasConverged_ = false;
+      bool isJacobianFrozen = false;
+      double lastUpdateVecNorm = 0.0;
       for(iterationNum_=0;iterationNum_<maxNumIteration_ && !hasConverged_ && !cancelIteration_;iterationNum_++){
-        this->jacState(H_,linState_);
-        this->jacNoise(Hn_,linState_);
+        if(!isJacobianFrozen){
+          this->jacState(H_,linState_);
+          this->jacNoise(Hn_,linState_);
+          jacobianEvaluationCount_++;
+          if(useJacobianFreezing_) Hlin_ = H_; // Keep Jacobian unaffected by outlier detection
+        }
         this->evalInnovationShort(y_,linState_);
+        y_.boxMinus(yIdentity_,innVector_);
 
-        if(isCoupled){
-          C_ = filterState.G_*preupdnoiP_*Hn_.transpose();
-          Py_ = H_*filterState.cov_*H_.transpose() + Hn_*updnoiP_*Hn_.transpose() + H_*C_ + C_.transpose()*H_.transpose();
-        } else {
-          Py_ = H_*filterState.cov_*H_.transpose() + Hn_*updnoiP_*Hn_.transpose();
+        if(isJacobianFrozen && useBroydenUpdate_ && updateVecLast_.squaredNorm() > 0.0){
+          Hlin_ += (innVector_-innVectorLast_-Hlin_*updateVecLast_)*updateVecLast_.transpose()/updateVecLast_.squaredNorm();
+          H_ = Hlin_;
         }
-        y_.boxMinus(yIdentity_,innVector_);
+        if(!isJacobianFrozen || useBroydenUpdate_){ // Otherwise Py_, Pyinv_ and K_ of the last iteration remain valid
+          if(isCoupled){
+            C_ = getPredictionWorkspace(filterState).G_*preupdnoiP_*Hn_.transpose();
+            Py_ = H_*filterState.cov_*H_.transpose() + Hn_*updnoiP_*Hn_.transpose() + H_*C_ + C_.transpose()*H_.transpose();
+          } else {
+            Py_ = H_*filterState.cov_*H_.transpose() + Hn_*updnoiP_*Hn_.transpose();
+          }
 
-        // Outlier detection
-        outlierDetection_.doOutlierDetection(innVector_,Py_,H_);
-        Pyinv_.setIdentity();
-        Py_.llt().solveInPlace(Pyinv_);
+          // Outlier detection
+          if(usePreGating_) cachePreGatingPyDiag();
+          outlierDetection_.doOutlierDetection(innVector_,Py_,H_);
+          Pyinv_.setIdentity();
+          Py_.llt().solveInPlace(Pyinv_);
 
-        // Kalman Update
-        if(isCoupled){
-          K_ = (filterState.cov_*H_.transpose()+C_)*Pyinv_;
-        } else {
-          K_ = filterState.cov_*H_.transpose()*Pyinv_;
+          // Kalman Update
+          if(isCoupled){
+            K_ = (filterState.cov_*H_.transpose()+C_)*Pyinv_;
+          } else {
+            K_ = filterState.cov_*H_.transpose()*Pyinv_;
+          }
         }
         filterState.state_.boxMinus(linState_,difVecLinInv_);
         updateVec_ = -K_*(innVector_+H_*difVecLinInv_)+difVecLinInv_; // includes correction for offseted linearization point, dif must be recomputed (a-b != (-(b-a)))
         linState_.boxPlus(updateVec_,linState_);
+        innVectorLast_ = innVector_;
+        updateVecLast_ = updateVec_;
+        lastUpdateVecNorm = updateVecNorm_;
         updateVecNorm_ = updateVec_.norm();
         hasConverged_ = updateVecNorm_<=updateVecNormTermination_;
+        if(!hasConverged_ && useAdaptiveTermination_ && iterationNum_>0 && updateVecNorm_<lastUpdateVecNorm){
+          const double rate = updateVecNorm_/lastUpdateVecNorm; // Estimate of linear contraction rate
+          hasConverged_ = rate/(1.0-rate)*updateVecNorm_<=updateVecNormTermination_;
+        }
+        if(useJacobianFreezing_ && updateVecNorm_<=jacobianFreezingTh_){
+          isJacobianFrozen = true;
+        }
       }
+      recordIterationNum(iterationNum_);
       if(extraOutlierCheck(linState_)){
         successfulUpdate_ = true;
         double score = (innVector_.transpose()*Pyinv_*innVector_)(0);
@@ -337,9 +921,11 @@ class Update: public ModelBase<Update<Innovation,FilterState,Meas,Noise,OutlierD
     return 0;
   }
   int performUpdateUKF(mtFilterState& filterState, const mtMeas& meas){
-    meas_ = meas;
+    PointerGuard<const mtMeas> measGuard(meas_);
+    meas_ = &meas;
     handleUpdateSigmaPoints<isCoupled>(filterState);
     y_.boxMinus(yIdentity_,innVector_);
+    if(usePreGating_) cachePreGatingPyDiag();
 
     outlierDetection_.doOutlierDetection(innVector_,Py_,Pyx_);
     Pyinv_.setIdentity();
@@ -361,13 +947,23 @@ class Update: public ModelBase<Update<Innovation,FilterState,Meas,Noise,OutlierD
   }
   template<bool IC = isCoupled, typename std::enable_if<(IC)>::type* = nullptr>
   void handleUpdateSigmaPoints(mtFilterState& filterState){
-    coupledStateSigmaPointsNoi_.extendZeroMeanGaussian(filterState.stateSigmaPointsNoi_,updnoiP_,preupdnoiP_);
+    const typename mtFilterState::mtPredictionWorkspace& predictionWorkspace = getPredictionWorkspace(filterState);
+    coupledStateSigmaPointsNoi_.extendZeroMeanGaussian(predictionWorkspace.stateSigmaPointsNoi_,updnoiP_,preupdnoiP_);
     for(unsigned int i=0;i<coupledInnSigmaPoints_.L_;i++){
-      this->evalInnovation(coupledInnSigmaPoints_(i),filterState.stateSigmaPointsPre_(i),coupledStateSigmaPointsNoi_(i));
+      this->evalInnovation(coupledInnSigmaPoints_(i),predictionWorkspace.stateSigmaPointsPre_(i),coupledStateSigmaPointsNoi_(i));
     }
     coupledInnSigmaPoints_.getMean(y_);
     coupledInnSigmaPoints_.getCovarianceMatrix(y_,Py_);
-    coupledInnSigmaPoints_.getCovarianceMatrix(filterState.stateSigmaPointsPre_,Pyx_);
+    coupledInnSigmaPoints_.getCovarianceMatrix(predictionWorkspace.stateSigmaPointsPre_,Pyx_);
+  }
+  /*!
+   * Workspace of the prediction preceding a coupled update (see FilterState::predictionWorkspace_).
+   */
+  const typename mtFilterState::mtPredictionWorkspace& getPredictionWorkspace(const mtFilterState& filterState) const{
+    if(filterState.predictionWorkspace_ == nullptr){
+      throw std::runtime_error("Coupled update without preceding prediction.");
+    }
+    return *filterState.predictionWorkspace_;
   }
   template<bool IC = isCoupled, typename std::enable_if<(!IC)>::type* = nullptr>
   void handleUpdateSigmaPoints(mtFilterState& filterState){
@@ -389,11 +985,12 @@ class Update: public ModelBase<Update<Innovation,FilterState,Meas,Noise,OutlierD
     return testUpdateJacs(state,meas,d,th);
   }
   bool testUpdateJacs(const mtState& state, const mtMeas& meas, double d = 1e-6,double th = 1e-6){
+    PointerGuard<const mtMeas> measGuard(meas_);
     mtInputTuple inputs;
     const double dt = 1.0;
     std::get<0>(inputs) = state;
     std::get<1>(inputs).setIdentity(); // Noise is always set to zero for Jacobians
-    meas_ = meas;
+    meas_ = &meas;
     return this->testJacs(inputs,d,th,dt);
   }
 };
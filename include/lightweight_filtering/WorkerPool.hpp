@@ -0,0 +1,92 @@
+/*
+ * WorkerPool.hpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef LWF_WORKERPOOL_HPP_
+#define LWF_WORKERPOOL_HPP_
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace LWF{
+
+/*!
+ * Minimal pool of worker threads executing tasks in FIFO order. Threads are started lazily (setNumThreads) and joined
+ * after all queued tasks have been processed when the pool shrinks or is destroyed.
+ */
+class WorkerPool{
+ public:
+  WorkerPool(): stop_(false){};
+  virtual ~WorkerPool(){
+    joinAll();
+  };
+  /*!
+   * Shrinking first finishes the queued tasks and joins all threads before the new ones are started.
+   */
+  void setNumThreads(unsigned int n){
+    if(n < workers_.size()) joinAll();
+    while(workers_.size() < n){
+      workers_.emplace_back(&WorkerPool::run,this);
+    }
+  }
+  unsigned int getNumThreads() const{
+    return workers_.size();
+  }
+  std::shared_future<void> enqueue(const std::function<void()>& task){
+    std::shared_ptr<std::packaged_task<void()>> packagedTask(new std::packaged_task<void()>(task));
+    std::shared_future<void> future = packagedTask->get_future().share();
+    if(workers_.empty()){ // Execute inline if there are no worker threads
+      (*packagedTask)();
+      return future;
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      tasks_.push([packagedTask](){(*packagedTask)();});
+    }
+    condition_.notify_one();
+    return future;
+  }
+ private:
+  void joinAll(){
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    condition_.notify_all();
+    for(auto it = workers_.begin();it!=workers_.end();it++){
+      it->join();
+    }
+    workers_.clear();
+    stop_ = false;
+  }
+  void run(){
+    while(true){
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock,[this]{return stop_ || !tasks_.empty();});
+        if(stop_ && tasks_.empty()) return;
+        task = std::move(tasks_.front());
+        tasks_.pop();
+      }
+      task();
+    }
+  }
+  std::vector<std::thread> workers_;
+  std::queue<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stop_;
+};
+
+}
+
+#endif /* LWF_WORKERPOOL_HPP_ */
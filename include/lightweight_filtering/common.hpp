@@ -40,6 +40,43 @@ namespace LWF{
     ModeUKF,
     ModeIEKF
   };
+  /*!
+   * Action of a MeasurementTimeline which reached its capacity (maxSize_).
+   */
+  enum CapacityPolicy{
+    PolicyDropOldest, // Drop the oldest measurement
+    PolicyReject, // Reject the new measurement (backpressure, addMeas returns false)
+    PolicyDecimate, // Merge the oldest measurement into its successor (mergeMeas_)
+    PolicySpill // Hand the oldest measurement to spillMeas_ (e.g. for writing it to disk) and drop it
+  };
+  /*!
+   * Restores a non-owning pointer (e.g. the measurement pointer of a model) to its previous value at the end of the
+   * scope, such that it never outlives the object it points to.
+   */
+  template<typename T>
+  class PointerGuard{
+   public:
+    PointerGuard(T*& pointer): pointer_(pointer), previous_(pointer){};
+    ~PointerGuard(){
+      pointer_ = previous_;
+    }
+    PointerGuard(const PointerGuard&) = delete;
+    PointerGuard& operator=(const PointerGuard&) = delete;
+   private:
+    T*& pointer_;
+    T* previous_;
+  };
+  /*!
+   * Heap memory (in bytes) held by dynamic-size Eigen objects, fixed-size objects are part of the enclosing class.
+   */
+  inline size_t heapMemory(){
+    return 0;
+  }
+  template<typename Derived, typename... Others>
+  inline size_t heapMemory(const Eigen::PlainObjectBase<Derived>& m, const Others&... others){
+    const bool isDynamic = Derived::RowsAtCompileTime == Eigen::Dynamic || Derived::ColsAtCompileTime == Eigen::Dynamic;
+    return (isDynamic ? m.size()*sizeof(typename Derived::Scalar) : 0) + heapMemory(others...);
+  }
 }
 
 #endif /* LWF_COMMON_HPP_ */
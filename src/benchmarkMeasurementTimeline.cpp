@@ -0,0 +1,79 @@
+#include "lightweight_filtering/MeasurementTimeline.hpp"
+#include <chrono>
+#include <iostream>
+#include <map>
+
+/*
+ * Compares std::map against the ring buffer used by MeasurementTimeline for a typical visual-inertial stream:
+ * a 1 kHz IMU (with occasional out-of-order samples) together with 20 Hz and 60 Hz cameras, which arrive with a latency
+ * of 5 ms. The filter is emulated by advancing the safe time every 10 ms, stepping through the IMU samples with
+ * upper_bound, collecting the camera measurements of each step and cleaning the processed data.
+ */
+
+struct Meas{
+  double data_[6];
+};
+typedef std::shared_ptr<Meas> MeasPtr;
+
+template<typename Map>
+void clean(Map& map, double t){
+  if(map.size() > 1){
+    typename Map::iterator itEnd = map.upper_bound(t);
+    if(itEnd == map.end()) --itEnd;
+    map.erase(map.begin(),itEnd);
+  }
+}
+
+template<typename Map>
+unsigned long countBetween(const Map& map, double t0, double t1){
+  unsigned long n = 0;
+  for(typename Map::const_iterator it = map.upper_bound(t0);it != map.end() && it->first <= t1;++it) n++;
+  return n;
+}
+
+template<typename Map>
+double run(double duration, unsigned long& checksum){
+  Map imu, cam20, cam60;
+  MeasPtr meas = std::make_shared<Meas>();
+  const double camLatency = 5e-3;
+  const double cam60Rate = 60.0;
+  unsigned int n60 = 0; // Index of the last 60 Hz frame, sampled at n60/cam60Rate
+  double tSafe = 0.0;
+  const auto start = std::chrono::steady_clock::now();
+  for(unsigned int k=1;k<=duration*1000;k++){
+    double t = k*1e-3;
+    if(k%50 == 0){ // Late sample
+      imu[t-2e-3] = meas;
+    } else if(k%50 != 48){
+      imu[t] = meas;
+    }
+    if(k%50 == 0) cam20[t-camLatency] = meas;
+    while((n60+1)/cam60Rate+camLatency <= t){
+      n60++;
+      cam60[n60/cam60Rate] = meas;
+    }
+    if(k%10 == 0){
+      const double tTarget = t-10e-3;
+      typename Map::iterator it;
+      while((it = imu.upper_bound(tSafe)) != imu.end() && it->first <= tTarget){
+        checksum += countBetween(cam20,tSafe,it->first) + countBetween(cam60,tSafe,it->first);
+        tSafe = it->first;
+      }
+      clean(imu,tSafe);
+      clean(cam20,tSafe);
+      clean(cam60,tSafe);
+    }
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+}
+
+int main(int argc, char** argv){
+  const double duration = 600.0;
+  unsigned long checksumMap = 0, checksumRing = 0;
+  const double tMap = run<std::map<double,MeasPtr>>(duration,checksumMap);
+  const double tRing = run<LWF::MeasurementTimeline<Meas>::mtMeasMap>(duration,checksumRing);
+  std::cout << "Simulated " << duration << " s of 1 kHz IMU + 20/60 Hz camera data" << std::endl;
+  std::cout << "  std::map:       " << tMap*1e3 << " ms (checksum " << checksumMap << ")" << std::endl;
+  std::cout << "  TimeRingBuffer: " << tRing*1e3 << " ms (checksum " << checksumRing << ")" << std::endl;
+  return checksumMap == checksumRing ? 0 : 1;
+}
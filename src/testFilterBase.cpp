@@ -3,6 +3,8 @@
 #include "lightweight_filtering/common.hpp"
 #include "gtest/gtest.h"
 #include <assert.h>
+#include <atomic>
+#include <thread>
 
 using namespace LWFTest;
 
@@ -40,11 +42,22 @@ TEST_F(MeasurementTimelineTest, addMeas) {
   for(int i=N_-1;i>=0;i--){ // Reverse for detecting FrontWarning
     timeline_.addMeas(values_[i],times_[i]);
     for(int j=N_-1;j>=i;j--){
-      ASSERT_EQ(timeline_.measMap_.at(times_[j]),values_[j]);
+      ASSERT_EQ(*timeline_.measMap_.at(times_[j]),values_[j]);
     }
   }
 }
 
+// Test shared and moved insertion
+TEST_F(MeasurementTimelineTest, addMeasShared) {
+  LWF::MeasurementTimeline<double>::mtMeasPtr meas = timeline_.makeMeasPtr(values_[0]);
+  timeline_.addMeas(meas,times_[0]);
+  ASSERT_EQ(timeline_.measMap_.at(times_[0]).get(),meas.get()); // No copy
+  timeline_.addMeas(std::move(values_[1]),times_[1]);
+  timeline_.emplaceMeas(times_[2],values_[2]);
+  ASSERT_EQ(timeline_.getMeas(times_[1]),values_[1]);
+  ASSERT_EQ(timeline_.getMeas(times_[2]),values_[2]);
+}
+
 // Test clean
 TEST_F(MeasurementTimelineTest, clean) {
   for(unsigned int i=0;i<N_;i++){
@@ -52,7 +65,7 @@ TEST_F(MeasurementTimelineTest, clean) {
   }
   timeline_.clean(times_[N_-2]);
   ASSERT_EQ(timeline_.measMap_.size(),1);
-  ASSERT_EQ(timeline_.measMap_.at(times_[N_-1]),values_[N_-1]);
+  ASSERT_EQ(*timeline_.measMap_.at(times_[N_-1]),values_[N_-1]);
 }
 
 // Test getNextTime
@@ -124,6 +137,132 @@ TEST_F(MeasurementTimelineTest, hasMeasurementAt) {
   ASSERT_EQ(r,false);
 }
 
+// Test ring buffer storage (wrap around, growth and out-of-order insertion)
+TEST_F(MeasurementTimelineTest, ringBuffer) {
+  LWF::TimeRingBuffer<double> buffer(4);
+  for(unsigned int i=0;i<3;i++){
+    buffer[i] = i;
+  }
+  buffer.erase(buffer.begin(),buffer.upper_bound(1.0));
+  ASSERT_EQ(buffer.size(),1);
+  for(unsigned int i=3;i<6;i++){ // Wraps around
+    buffer[i] = i;
+  }
+  ASSERT_EQ(buffer.capacity(),4);
+  buffer[2.5] = 2.5; // Out-of-order, forces growth
+  buffer[10.0] = 10.0;
+  buffer[-1.0] = -1.0;
+  ASSERT_EQ(buffer.size(),7);
+  double last = -2.0;
+  for(LWF::TimeRingBuffer<double>::const_iterator it=buffer.begin();it!=buffer.end();it++){
+    ASSERT_TRUE(it->first > last);
+    ASSERT_EQ(it->first,it->second);
+    last = it->first;
+  }
+  ASSERT_EQ(buffer.rbegin()->first,10.0);
+  ASSERT_EQ(buffer.upper_bound(2.5)->first,3.0);
+  ASSERT_EQ(buffer.lower_bound(2.5)->first,2.5);
+  ASSERT_TRUE(buffer.upper_bound(10.0) == buffer.end());
+  ASSERT_EQ(buffer.count(4.0),1);
+  ASSERT_EQ(buffer.count(4.5),0);
+  buffer.erase(3.0);
+  ASSERT_EQ(buffer.count(3.0),0);
+  ASSERT_EQ(buffer.at(4.0),4.0);
+  ASSERT_THROW(buffer.at(4.5),std::out_of_range);
+}
+
+// Test lock-free input queue
+TEST_F(MeasurementTimelineTest, inputQueue) {
+  LWF::LockFreeQueue<int> queue(3);
+  ASSERT_EQ(queue.capacity(),4);
+  for(int i=0;i<4;i++){
+    ASSERT_TRUE(queue.push(i));
+  }
+  ASSERT_TRUE(!queue.push(4));
+  int value;
+  for(int i=0;i<4;i++){
+    ASSERT_TRUE(queue.pop(value));
+    ASSERT_EQ(value,i);
+  }
+  ASSERT_TRUE(!queue.pop(value));
+  ASSERT_TRUE(queue.empty());
+}
+
+// Test capacity limit and policies
+TEST_F(MeasurementTimelineTest, capacity) {
+  timeline_.maxSize_ = 3;
+  for(unsigned int i=0;i<N_;i++){
+    ASSERT_TRUE(timeline_.addMeas(values_[i],times_[i]));
+  }
+  ASSERT_EQ(timeline_.measMap_.size(),3);
+  ASSERT_EQ(timeline_.measMap_.begin()->first,times_[2]);
+  ASSERT_EQ(timeline_.countDropped_,2);
+  ASSERT_FALSE(timeline_.addMeas(values_[0],times_[0])); // Older than all buffered measurements
+  ASSERT_EQ(timeline_.measMap_.size(),3);
+  ASSERT_EQ(timeline_.measMap_.begin()->first,times_[2]);
+  ASSERT_EQ(timeline_.countDropped_,3);
+
+  timeline_.clear();
+  timeline_.capacityPolicy_ = LWF::PolicyReject;
+  for(unsigned int i=0;i<N_;i++){
+    ASSERT_EQ(timeline_.addMeas(values_[i],times_[i]),i<3);
+  }
+  ASSERT_TRUE(timeline_.addMeas(values_[0],times_[1])); // Replacing is possible
+  ASSERT_EQ(timeline_.measMap_.rbegin()->first,times_[2]);
+  ASSERT_EQ(timeline_.countRejected_,2);
+  timeline_.clear();
+  timeline_.maxSize_ = 1; // Treated as 2, like for the other policies
+  for(unsigned int i=0;i<N_;i++){
+    ASSERT_EQ(timeline_.addMeas(values_[i],times_[i]),i<2);
+  }
+  ASSERT_EQ(timeline_.measMap_.size(),2);
+  timeline_.maxSize_ = 3;
+
+  timeline_.clear();
+  timeline_.capacityPolicy_ = LWF::PolicyDecimate;
+  timeline_.mergeMeas_ = [](const double& older, double tOlder, double& newer, double tNewer){
+    newer += older;
+  };
+  LWF::MeasurementTimeline<double>::mtMeasPtr meas = timeline_.makeMeasPtr(values_[1]);
+  timeline_.addMeas(values_[0],times_[0]);
+  timeline_.addMeas(meas,times_[1]);
+  for(unsigned int i=2;i<N_;i++){
+    timeline_.addMeas(values_[i],times_[i]);
+  }
+  ASSERT_EQ(timeline_.measMap_.size(),3);
+  ASSERT_EQ(timeline_.getMeas(times_[2]),values_[0]+values_[1]+values_[2]);
+  ASSERT_EQ(*meas,values_[1]); // Shared measurements are not modified
+  ASSERT_EQ(timeline_.countDecimated_,2);
+  ASSERT_FALSE(timeline_.addMeas(values_[1],times_[1])); // Older than all buffered measurements, merged right away
+  ASSERT_EQ(timeline_.measMap_.size(),3);
+  ASSERT_EQ(timeline_.measMap_.begin()->first,times_[2]);
+  ASSERT_EQ(timeline_.getMeas(times_[2]),values_[0]+2*values_[1]+values_[2]);
+  ASSERT_EQ(timeline_.countDecimated_,3);
+
+  timeline_.clear();
+  timeline_.capacityPolicy_ = LWF::PolicySpill;
+  std::vector<double> spilled;
+  timeline_.spillMeas_ = [&spilled](const LWF::MeasurementTimeline<double>::mtMeasPtr& meas, double t){
+    spilled.push_back(t);
+  };
+  for(unsigned int i=0;i<N_;i++){
+    timeline_.addMeas(values_[i],times_[i]);
+  }
+  ASSERT_EQ(spilled.size(),2);
+  ASSERT_EQ(spilled[1],times_[1]);
+  ASSERT_EQ(timeline_.countSpilled_,2);
+  ASSERT_FALSE(timeline_.addMeas(values_[0],times_[0])); // Older than all buffered measurements, spilled right away
+  ASSERT_EQ(timeline_.measMap_.size(),3);
+  ASSERT_EQ(spilled.size(),3);
+  ASSERT_EQ(spilled[2],times_[0]);
+  ASSERT_EQ(timeline_.countSpilled_,3);
+  const size_t capacity = timeline_.measMap_.capacity();
+  for(unsigned int i=0;i<100;i++){
+    timeline_.addMeas(values_[0],times_[N_-1]+i+1.0);
+  }
+  ASSERT_EQ(timeline_.measMap_.capacity(),capacity); // Memory stays flat
+}
+
 // The fixture for testing class FilterBase
 template<typename TestClass>
 class FilterBaseTest : public ::testing::Test, public TestClass {
@@ -295,6 +434,574 @@ TYPED_TEST(FilterBaseTest, updateSafe) {
   ASSERT_EQ(std::get<0>(this->testFilter_.updateTimelineTuple_).measMap_.size(),1);
 }
 
+// Test that the prediction workspace is owned by the model and not referenced by copies of the filter state
+TYPED_TEST(FilterBaseTest, predictionWorkspace) {
+  ASSERT_TRUE(this->testFilter_.safe_.predictionWorkspace_ == nullptr);
+  this->testFilter_.addPredictionMeas(this->testPredictionMeas_,0.1);
+  this->testFilter_.template addUpdateMeas<0>(this->testUpdateMeas_,0.1);
+  this->testFilter_.updateSafe();
+  ASSERT_TRUE(this->testFilter_.safe_.predictionWorkspace_ == &this->testFilter_.mPrediction_.workspace_);
+  typename TestFixture::mtFilterState filterState = this->testFilter_.safe_;
+  ASSERT_TRUE(filterState.predictionWorkspace_ == nullptr);
+  ASSERT_EQ(filterState.t_,this->testFilter_.safe_.t_);
+  ASSERT_NEAR((filterState.cov_-this->testFilter_.safe_.cov_).norm(),0.0,1e-10);
+  filterState.predictionWorkspace_ = &this->testFilter_.mPrediction_.workspace_;
+  filterState = this->testFilter_.safe_;
+  ASSERT_TRUE(filterState.predictionWorkspace_ == nullptr);
+  ASSERT_EQ(filterState.memoryFootprint(),sizeof(filterState)+filterState.cov_.size()*sizeof(double));
+}
+
+// Test rollback to checkpoints of the safe branch for late measurements
+TYPED_TEST(FilterBaseTest, rollback) {
+  this->testFilter_.useRollback_ = true;
+  std::get<0>(this->testFilter_.updateTimelineTuple_).maxWaitTime_ = 0.0;
+  std::get<0>(this->testFilter2_.updateTimelineTuple_).maxWaitTime_ = 0.0;
+  for(unsigned int i=1;i<=4;i++){
+    this->testFilter_.addPredictionMeas(this->testPredictionMeas_,i*0.1);
+    this->testFilter2_.addPredictionMeas(this->testPredictionMeas_,i*0.1);
+  }
+  this->testFilter2_.template addUpdateMeas<0>(this->testUpdateMeas_,0.2);
+  this->testFilter_.updateSafe();
+  ASSERT_EQ(this->testFilter_.safe_.t_,0.4);
+  ASSERT_TRUE(this->testFilter_.template addUpdateMeas<0>(this->testUpdateMeas_,0.2)); // Late, but can be rolled back
+  this->testFilter_.updateSafe();
+  this->testFilter2_.updateSafe();
+  ASSERT_EQ(this->testFilter_.rollbackCount_,1);
+  ASSERT_EQ(this->testFilter_.safe_.t_,0.4);
+  this->testFilter_.safe_.state_.boxMinus(this->testFilter2_.safe_.state_,this->difVec_);
+  ASSERT_NEAR(this->difVec_.norm(),0.0,1e-10);
+  ASSERT_NEAR((this->testFilter_.safe_.cov_-this->testFilter2_.safe_.cov_).norm(),0.0,1e-10);
+
+  // Older than all checkpoints
+  this->testFilter_.rollbackHorizon_ = 0.0;
+  this->testFilter_.addPredictionMeas(this->testPredictionMeas_,0.5);
+  this->testFilter_.updateSafe();
+  ASSERT_EQ(this->testFilter_.checkpoints_.size(),1);
+  std::cout << "Should print warning (1):" << std::endl;
+  ASSERT_TRUE(!this->testFilter_.template addUpdateMeas<0>(this->testUpdateMeas_,0.3));
+
+  // Pushed measurements report the result of the drain
+  this->testFilter_.rollbackHorizon_ = 1.0;
+  this->testFilter_.addPredictionMeas(this->testPredictionMeas_,0.6);
+  this->testFilter_.updateSafe();
+  ASSERT_EQ(this->testFilter_.safe_.t_,0.6);
+  ASSERT_EQ(this->testFilter_.checkpoints_.front().t_,0.5);
+  ASSERT_TRUE(this->testFilter_.template pushUpdateMeas<0>(this->testUpdateMeas_,0.55)); // Late, but can be rolled back
+  ASSERT_TRUE(!this->testFilter_.template pushUpdateMeas<0>(this->testUpdateMeas_,0.45));
+  std::cout << "Should print warning (1):" << std::endl;
+  this->testFilter_.drainInputQueues();
+  ASSERT_TRUE(this->testFilter_.rollbackPending_);
+  ASSERT_EQ(this->testFilter_.rollbackTime_,0.55);
+}
+
+// Test past-time queries on the state history of the safe branch
+TYPED_TEST(FilterBaseTest, queryState) {
+  typename TestFixture::mtState state;
+  Eigen::MatrixXd cov;
+  const int D = TestFixture::mtState::D_;
+  this->testFilter_.useStateHistory_ = true;
+  this->testFilter_.stateHistorySize_ = 3;
+  this->testFilter_.stateHistoryCovBlocks_.push_back(std::make_pair(0,2));
+  this->testFilter_.stateHistoryCovBlocks_.push_back(std::make_pair(D-1,1));
+  std::get<0>(this->testFilter_.updateTimelineTuple_).maxWaitTime_ = 0.0;
+  std::get<0>(this->testFilter2_.updateTimelineTuple_).maxWaitTime_ = 0.0;
+  for(unsigned int i=1;i<=4;i++){
+    this->testFilter_.addPredictionMeas(this->testPredictionMeas_,i*0.1);
+    this->testFilter2_.addPredictionMeas(this->testPredictionMeas_,i*0.1);
+  }
+  for(unsigned int i=1;i<=3;i++){ // One history entry per step, i.e. per update time and at the end
+    this->testFilter_.template addUpdateMeas<0>(this->testUpdateMeas_,i*0.1);
+    this->testFilter2_.template addUpdateMeas<0>(this->testUpdateMeas_,i*0.1);
+  }
+  ASSERT_TRUE(!this->testFilter_.queryState(0.1,state));
+  this->testFilter_.updateSafe();
+  ASSERT_EQ(this->testFilter_.stateHistory_.size(),3);
+  ASSERT_TRUE(!this->testFilter_.queryState(0.15,state)); // Dropped
+  ASSERT_TRUE(!this->testFilter_.queryState(0.45,state));
+
+  // Exact time stamp
+  const double t = 3*0.1; // Same rounding as the measurement time
+  this->testFilter2_.updateSafe(&t);
+  ASSERT_TRUE(this->testFilter_.queryState(t,state,&cov));
+  state.boxMinus(this->testFilter2_.safe_.state_,this->difVec_);
+  ASSERT_NEAR(this->difVec_.norm(),0.0,1e-10);
+  ASSERT_NEAR((cov.block(0,0,2,2)-this->testFilter2_.safe_.cov_.block(0,0,2,2)).norm(),0.0,1e-10);
+  ASSERT_NEAR(cov(D-1,D-1)-this->testFilter2_.safe_.cov_(D-1,D-1),0.0,1e-10);
+  ASSERT_NEAR(cov.block(2,2,D-3,D-3).norm(),0.0,1e-10);
+
+  // Interpolation
+  typename TestFixture::mtState state2;
+  Eigen::MatrixXd cov2;
+  ASSERT_TRUE(this->testFilter_.queryState(4*0.1,state2,&cov2));
+  ASSERT_TRUE(this->testFilter_.queryState(0.75*t+0.25*4*0.1,state,&cov));
+  typename TestFixture::mtState::mtDifVec difVec;
+  state2.boxMinus(this->testFilter2_.safe_.state_,difVec);
+  state.boxMinus(this->testFilter2_.safe_.state_,this->difVec_);
+  ASSERT_NEAR((this->difVec_-0.25*difVec).norm(),0.0,1e-8);
+  ASSERT_NEAR((cov-0.75*this->testFilter2_.safe_.cov_.block(0,0,D,D)-0.25*cov2).block(0,0,2,2).norm(),0.0,1e-8);
+
+  this->testFilter_.reset();
+  ASSERT_TRUE(this->testFilter_.stateHistory_.empty());
+}
+
+// Prediction which holds the last measurement if none is available
+template<typename PredictionExample>
+class HoldLastPredictionExample: public PredictionExample{
+ public:
+  typename PredictionExample::mtMeas last_;
+  void noMeasCase(typename PredictionExample::mtFilterState& filterState, typename PredictionExample::mtMeas& meas, double dt){
+    meas = last_;
+  }
+  void noMeasCaseMean(const typename PredictionExample::mtState& state, typename PredictionExample::mtMeas& meas, double dt) const{
+    meas = last_;
+  }
+};
+
+// Prediction which does not support merging (like GIF predictions)
+template<typename PredictionExample>
+class NoMergePredictionExample: public PredictionExample{
+ public:
+  static const bool canMerge_ = false;
+};
+
+// Test the mean-only extrapolation
+TYPED_TEST(FilterBaseTest, extrapolate) {
+  typename TestFixture::mtState state;
+  Eigen::MatrixXd cov;
+  for(unsigned int i=1;i<=4;i++){
+    this->testFilter_.addPredictionMeas(this->testPredictionMeas_,i*0.1);
+    this->testFilter2_.addPredictionMeas(this->testPredictionMeas_,i*0.1);
+  }
+  this->testFilter_.updateFront(0.2);
+  ASSERT_TRUE(!this->testFilter_.extrapolate(this->testFilter_.safe_.t_-0.1,state));
+  const typename TestFixture::mtFilterState front = this->testFilter_.front_;
+
+  // Up to a prediction measurement and beyond the newest one (same steps as updateFront on testFilter2_)
+  const double times[2] = {3*0.1,0.45};
+  for(const double t : times){
+    ASSERT_TRUE(this->testFilter_.extrapolate(t,state,&cov));
+    this->testFilter2_.updateFront(t);
+    state.boxMinus(this->testFilter2_.front_.state_,this->difVec_);
+    ASSERT_NEAR(this->difVec_.norm(),0.0,1e-10);
+    ASSERT_NEAR((cov-front.cov_).norm(),0.0,1e-10);
+  }
+  ASSERT_EQ(this->testFilter_.front_.t_,front.t_);
+  this->testFilter_.front_.state_.boxMinus(front.state_,this->difVec_);
+  ASSERT_NEAR(this->difVec_.norm(),0.0,1e-10);
+
+  // Beyond the newest prediction measurement the measurement is filled by noMeasCase
+  typedef HoldLastPredictionExample<typename TestFixture::mtPredictionExample> mtHoldLastPrediction;
+  LWF::FilterBase<mtHoldLastPrediction,typename TestFixture::mtUpdateExample> holdFilter;
+  LWF::FilterBase<mtHoldLastPrediction,typename TestFixture::mtUpdateExample> refFilter;
+  holdFilter.mPrediction_.last_ = this->testPredictionMeas_;
+  for(unsigned int i=1;i<=5;i++){
+    if(i<5) holdFilter.addPredictionMeas(this->testPredictionMeas_,i*0.1);
+    refFilter.addPredictionMeas(this->testPredictionMeas_,i*0.1);
+  }
+  typename TestFixture::mtState refState;
+  ASSERT_TRUE(holdFilter.extrapolate(0.45,state));
+  ASSERT_TRUE(refFilter.extrapolate(0.45,refState));
+  state.boxMinus(refState,this->difVec_);
+  ASSERT_NEAR(this->difVec_.norm(),0.0,1e-10);
+}
+
+// Test the batched multi-horizon prediction
+TYPED_TEST(FilterBaseTest, predictHorizon) {
+  const int D = TestFixture::mtState::D_;
+  for(unsigned int i=1;i<=4;i++){
+    this->testFilter_.addPredictionMeas(this->testPredictionMeas_,i*0.1);
+    this->testFilter2_.addPredictionMeas(this->testPredictionMeas_,i*0.1);
+  }
+  this->testFilter_.updateFront(0.2);
+  this->testFilter2_.updateFront(0.2);
+  const typename TestFixture::mtFilterState front = this->testFilter_.front_;
+  const Eigen::MatrixXd F = this->testFilter_.mPrediction_.workspace_.F_;
+  const double times[4] = {3*0.1,0.45,0.55,0.65};
+  ASSERT_TRUE(this->testFilter_.predictHorizon(times,4));
+  ASSERT_EQ(this->testFilter_.horizonStates_.size(),4u);
+  ASSERT_EQ(this->testFilter_.horizonCovs_.cols(),4*D);
+  for(int k=0;k<4;k++){
+    this->testFilter2_.updateFront(times[k]);
+    this->testFilter_.horizonStates_[k].boxMinus(this->testFilter2_.front_.state_,this->difVec_);
+    ASSERT_NEAR(this->difVec_.norm(),0.0,1e-10);
+    ASSERT_NEAR((this->testFilter_.horizonCovs_.block(0,k*D,D,D)-this->testFilter2_.front_.cov_).norm(),0.0,1e-8);
+  }
+  ASSERT_EQ(this->testFilter_.front_.t_,front.t_);
+  ASSERT_NEAR((this->testFilter_.front_.cov_-front.cov_).norm(),0.0,1e-10);
+  ASSERT_TRUE(this->testFilter_.mPrediction_.workspace_.F_ == F); // Runs on the horizon workspace of the model
+  ASSERT_TRUE(this->testFilter_.horizonState_.predictionWorkspace_ == &this->testFilter_.mPrediction_.horizonWorkspace_);
+
+  // Reused Jacobians for the constant-input steps, exact for the linear model
+  const Eigen::MatrixXd covs = this->testFilter_.horizonCovs_;
+  ASSERT_TRUE(this->testFilter_.predictHorizon(times,4,true));
+  if(this->id_ == 1){
+    ASSERT_NEAR((this->testFilter_.horizonCovs_-covs).norm(),0.0,1e-8);
+  } else {
+    ASSERT_NEAR((this->testFilter_.horizonCovs_-covs).leftCols(3*D).norm(),0.0,1e-8);
+  }
+
+  // Two-thread operation, starts from asyncFront_ with the front prediction model and timeline
+  this->testFilter_.safeThreadPeriod_ = 100.0; // No snapshot is published in between
+  this->testFilter_.startSafeThread();
+  ASSERT_TRUE(this->testFilter_.predictHorizon(times+1,3));
+  ASSERT_EQ(this->testFilter_.horizonStates_.size(),3u);
+  for(int k=0;k<3;k++){
+    const typename TestFixture::mtFilterState& asyncFront = this->testFilter_.predictFront(times[k+1]);
+    this->testFilter_.horizonStates_[k].boxMinus(asyncFront.state_,this->difVec_);
+    ASSERT_NEAR(this->difVec_.norm(),0.0,1e-10);
+    ASSERT_NEAR((this->testFilter_.horizonCovs_.block(0,k*D,D,D)-asyncFront.cov_).norm(),0.0,1e-8);
+  }
+  this->testFilter_.stopSafeThread();
+}
+
+// Test automatic safe updates driven by the watermark
+TYPED_TEST(FilterBaseTest, autoUpdateSafe) {
+  unsigned int callbackCount = 0;
+  double safeWatermark;
+  this->testFilter_.autoUpdateSafe_ = true;
+  this->testFilter_.minSafeBatchInterval_ = 0.15;
+  this->testFilter_.safeUpdateCallback_ = [&callbackCount](const typename TestFixture::mtFilterState& filterState){
+    callbackCount++;
+  };
+  std::get<0>(this->testFilter_.updateTimelineTuple_).maxWaitTime_ = 0.0;
+  std::get<0>(this->testFilter2_.updateTimelineTuple_).maxWaitTime_ = 0.0;
+  for(unsigned int i=1;i<=4;i++){
+    this->testFilter_.addPredictionMeas(this->testPredictionMeas_,i*0.1);
+    this->testFilter2_.addPredictionMeas(this->testPredictionMeas_,i*0.1);
+    ASSERT_EQ(this->testFilter_.safe_.t_,0.2*(i/2)); // Batches of two measurements
+  }
+  ASSERT_EQ(this->testFilter_.autoUpdateCount_,2);
+  ASSERT_EQ(callbackCount,2);
+  this->testFilter2_.updateSafe();
+  this->testFilter_.safe_.state_.boxMinus(this->testFilter2_.safe_.state_,this->difVec_);
+  ASSERT_NEAR(this->difVec_.norm(),0.0,1e-10);
+  ASSERT_NEAR((this->testFilter_.safe_.cov_-this->testFilter2_.safe_.cov_).norm(),0.0,1e-10);
+
+  // The watermark follows the newest measurement of each timeline
+  this->testFilter_.template addUpdateMeas<0>(this->testUpdateMeas_,0.45);
+  ASSERT_TRUE(this->testFilter_.getWatermark(safeWatermark));
+  ASSERT_EQ(safeWatermark,0.4);
+  this->testFilter_.addPredictionMeas(this->testPredictionMeas_,0.5); // Not enough for a batch
+  ASSERT_TRUE(this->testFilter_.watermarkValid_);
+  ASSERT_EQ(this->testFilter_.safeWatermark_,0.5);
+  this->testFilter_.updateSafe();
+  ASSERT_EQ(this->testFilter_.safe_.t_,0.5);
+  ASSERT_EQ(callbackCount,3);
+}
+
+// Test degradation and recovery by the latency governor
+TYPED_TEST(FilterBaseTest, latencyGovernor) {
+  std::get<0>(this->testFilter_.mUpdates_).mode_ = LWF::ModeIEKF;
+  std::get<0>(this->testFilter_.mUpdates_).useIndividualMode_ = true;
+  const int maxNumIteration = std::get<0>(this->testFilter_.mUpdates_).maxNumIteration_;
+  this->testFilter_.frontBudget_ = 1e-12; // Always exceeded
+  for(int i=1;i<=5;i++){
+    this->testFilter_.addPredictionMeas(this->testPredictionMeas_,0.1*i);
+    this->testFilter_.updateFront(0.1*i);
+    ASSERT_EQ(this->testFilter_.degradationLevel_,std::min(i,4));
+  }
+  ASSERT_EQ(this->testFilter_.overBudgetCount_,5);
+  ASSERT_EQ(this->testFilter_.degradationChangeCount_,4);
+  ASSERT_TRUE(this->testFilter_.logCountMerPre_ > 0);
+  ASSERT_EQ(std::get<0>(this->testFilter_.mUpdates_).maxNumIteration_,this->testFilter_.degradedMaxNumIteration_);
+  ASSERT_TRUE(std::get<0>(this->testFilter_.mUpdates_).mode_ == LWF::ModeEKF);
+  ASSERT_TRUE(this->testFilter_.mPrediction_.getMode(this->testFilter_.safe_) == LWF::ModeEKF);
+
+  // Recovery
+  this->testFilter_.frontBudget_ = 1e3;
+  this->testFilter_.recoveryCount_ = 2;
+  for(int i=6;i<=13;i++){
+    this->testFilter_.addPredictionMeas(this->testPredictionMeas_,0.1*i);
+    this->testFilter_.updateFront(0.1*i);
+    ASSERT_EQ(this->testFilter_.degradationLevel_,4-(i-5)/2);
+  }
+  ASSERT_EQ(std::get<0>(this->testFilter_.mUpdates_).maxNumIteration_,maxNumIteration);
+  ASSERT_TRUE(std::get<0>(this->testFilter_.mUpdates_).mode_ == LWF::ModeIEKF);
+  ASSERT_TRUE(std::get<0>(this->testFilter_.mUpdates_).useIndividualMode_);
+  ASSERT_TRUE(!this->testFilter_.mPrediction_.useIndividualMode_);
+
+  // Skipping of low priority updates
+  decltype(this->testFilter2_) filter;
+  std::get<0>(filter.updateTimelineTuple_).maxWaitTime_ = 1.0;
+  std::get<1>(filter.updateTimelineTuple_).maxWaitTime_ = 0.0;
+  this->testFilter2_.updatePriority_[0] = 1;
+  this->testFilter2_.setDegradationLevel(4);
+  this->testFilter2_.setDegradationLevel(4);
+  ASSERT_EQ(this->testFilter2_.degradationChangeCount_,1);
+  filter.safe_.usePredictionMerge_ = true;
+  this->testFilter2_.addPredictionMeas(this->testPredictionMeas_,0.1);
+  this->testFilter2_.template addUpdateMeas<0>(this->testUpdateMeas_,0.1);
+  this->testFilter2_.template addUpdateMeas<1>(this->testUpdateMeas_,0.1);
+  filter.addPredictionMeas(this->testPredictionMeas_,0.1);
+  filter.template addUpdateMeas<0>(this->testUpdateMeas_,0.1);
+  this->testFilter2_.updateSafe();
+  filter.updateSafe();
+  ASSERT_EQ(this->testFilter2_.safe_.t_,filter.safe_.t_);
+  this->testFilter2_.safe_.state_.boxMinus(filter.safe_.state_,this->difVec_);
+  ASSERT_NEAR(this->difVec_.norm(),0.0,1e-10);
+  ASSERT_NEAR((this->testFilter2_.safe_.cov_-filter.safe_.cov_).norm(),0.0,1e-10);
+
+  // Levels are limited by maxDegradationLevel_
+  this->testFilter2_.maxDegradationLevel_ = 2;
+  this->testFilter2_.setDegradationLevel(4);
+  ASSERT_EQ(this->testFilter2_.degradationLevel_,2);
+
+  // Adaptive escalation of the updates is disabled from level 3 on
+  this->testFilter2_.maxDegradationLevel_ = 4;
+  this->testFilter2_.setDegradationLevel(0);
+  std::get<0>(this->testFilter2_.mUpdates_).useAdaptiveMode_ = true; // Nominal setting, stored when leaving level 0
+  this->testFilter2_.setDegradationLevel(2);
+  ASSERT_TRUE(std::get<0>(this->testFilter2_.mUpdates_).useAdaptiveMode_);
+  this->testFilter2_.setDegradationLevel(3);
+  ASSERT_TRUE(!std::get<0>(this->testFilter2_.mUpdates_).useAdaptiveMode_);
+  ASSERT_TRUE(std::get<0>(this->testFilter2_.mUpdates_).mode_ == LWF::ModeEKF);
+  this->testFilter2_.setDegradationLevel(2);
+  ASSERT_TRUE(std::get<0>(this->testFilter2_.mUpdates_).useAdaptiveMode_);
+  this->testFilter2_.setDegradationLevel(0);
+  ASSERT_TRUE(std::get<0>(this->testFilter2_.mUpdates_).useAdaptiveMode_);
+
+  // Predictions which cannot merge skip level 1
+  LWF::FilterBase<NoMergePredictionExample<typename TestFixture::mtPredictionExample>,typename TestFixture::mtUpdateExample> noMergeFilter;
+  noMergeFilter.frontBudget_ = 1e-12; // Always exceeded
+  noMergeFilter.addPredictionMeas(this->testPredictionMeas_,0.1);
+  noMergeFilter.updateFront(0.1);
+  ASSERT_EQ(noMergeFilter.degradationLevel_,2);
+  noMergeFilter.addPredictionMeas(this->testPredictionMeas_,0.2);
+  noMergeFilter.updateFront(0.2);
+  ASSERT_EQ(noMergeFilter.logCountMerPre_,0);
+  ASSERT_TRUE(noMergeFilter.logCountRegPre_ > 0);
+  ASSERT_EQ(noMergeFilter.logCountBadPre_,0);
+}
+
+// Test the background safe thread and the front prediction on the caller's thread
+TYPED_TEST(FilterBaseTest, safeThread) {
+  this->testFilter_.safeThreadPeriod_ = 0.001;
+  this->testFilter_.startSafeThread();
+  for(int i=1;i<=5;i++){
+    this->testFilter_.pushPredictionMeas(this->testPredictionMeas_,0.1*i);
+    this->testFilter2_.addPredictionMeas(this->testPredictionMeas_,0.1*i);
+  }
+  this->testFilter2_.updateFront(0.5); // Safe cannot advance, waiting for update measurements
+  const typename TestFixture::mtFilterState& front = this->testFilter_.predictFront(0.5);
+  ASSERT_EQ(front.t_,0.5);
+  front.state_.boxMinus(this->testFilter2_.front_.state_,this->difVec_);
+  ASSERT_NEAR(this->difVec_.norm(),0.0,1e-10);
+  ASSERT_NEAR((front.cov_-this->testFilter2_.front_.cov_).norm(),0.0,1e-10);
+
+  // Safe advances in the background
+  const unsigned int version = this->testFilter_.publishedVersion_;
+  this->testFilter_.template pushUpdateMeas<0>(this->testUpdateMeas_,0.3);
+  this->testFilter2_.template addUpdateMeas<0>(this->testUpdateMeas_,0.3);
+  for(int i=0;i<5000 && this->testFilter_.publishedVersion_ == version;i++){
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_TRUE(this->testFilter_.publishedVersion_ != version);
+  this->testFilter2_.updateFront(0.5);
+  this->testFilter_.predictFront(0.5);
+  ASSERT_EQ(front.t_,0.5);
+  front.state_.boxMinus(this->testFilter2_.front_.state_,this->difVec_);
+  ASSERT_NEAR(this->difVec_.norm(),0.0,1e-10);
+  ASSERT_NEAR((front.cov_-this->testFilter2_.front_.cov_).norm(),0.0,1e-10);
+  // Extrapolation starts from asyncFront_ while the thread is running
+  typename TestFixture::mtState state;
+  typename TestFixture::mtState refState;
+  ASSERT_FALSE(this->testFilter_.extrapolate(0.4,state));
+  ASSERT_TRUE(this->testFilter_.extrapolate(0.5,state));
+  state.boxMinus(front.state_,this->difVec_);
+  ASSERT_NEAR(this->difVec_.norm(),0.0,1e-10);
+  ASSERT_TRUE(this->testFilter_.extrapolate(0.6,state));
+  ASSERT_TRUE(this->testFilter2_.extrapolate(0.6,refState));
+  state.boxMinus(refState,this->difVec_);
+  ASSERT_NEAR(this->difVec_.norm(),0.0,1e-10);
+  this->testFilter_.stopSafeThread();
+  ASSERT_EQ(this->testFilter_.safe_.t_,this->testFilter2_.safe_.t_);
+}
+
+// Test the front prediction of the safe thread over prediction measurements buffered before its start
+TYPED_TEST(FilterBaseTest, safeThreadBufferedMeas) {
+  for(int i=1;i<=3;i++){
+    this->testFilter_.addPredictionMeas(this->testPredictionMeas_,0.1*i);
+    this->testFilter2_.addPredictionMeas(this->testPredictionMeas_,0.1*i);
+  }
+  this->testFilter_.pushPredictionMeas(this->testPredictionMeas_,0.4); // Not drained yet
+  this->testFilter2_.addPredictionMeas(this->testPredictionMeas_,0.4);
+  this->testFilter_.startSafeThread();
+  this->testFilter_.pushPredictionMeas(this->testPredictionMeas_,0.5);
+  this->testFilter2_.addPredictionMeas(this->testPredictionMeas_,0.5);
+  this->testFilter2_.updateFront(0.5);
+  const typename TestFixture::mtFilterState& front = this->testFilter_.predictFront(0.5);
+  ASSERT_EQ(this->testFilter_.frontCountPre_[2],0u); // No prediction without measurement
+  ASSERT_EQ(front.t_,0.5);
+  front.state_.boxMinus(this->testFilter2_.front_.state_,this->difVec_);
+  ASSERT_NEAR(this->difVec_.norm(),0.0,1e-10);
+  ASSERT_NEAR((front.cov_-this->testFilter2_.front_.cov_).norm(),0.0,1e-10);
+  this->testFilter_.stopSafeThread();
+}
+
+// Test that prediction measurements pushed while the safe thread is starting reach the front prediction
+TYPED_TEST(FilterBaseTest, safeThreadConcurrentStart) {
+  const int N = 200;
+  for(int i=1;i<=N;i++){
+    this->testFilter2_.addPredictionMeas(this->testPredictionMeas_,0.001*i);
+  }
+  std::atomic<bool> go(false);
+  std::thread producer([this,&go,N]{
+    while(!go){}
+    for(int i=1;i<=N;i++){
+      this->testFilter_.pushPredictionMeas(this->testPredictionMeas_,0.001*i);
+    }
+  });
+  go = true;
+  this->testFilter_.startSafeThread();
+  producer.join();
+  this->testFilter2_.updateFront(0.001*N);
+  const typename TestFixture::mtFilterState& front = this->testFilter_.predictFront(0.001*N);
+  ASSERT_EQ(this->testFilter_.frontCountPre_[1],(unsigned int)N); // One step per pushed measurement
+  ASSERT_EQ(this->testFilter_.frontCountPre_[2],0u);
+  ASSERT_EQ(front.t_,0.001*N);
+  front.state_.boxMinus(this->testFilter2_.front_.state_,this->difVec_);
+  ASSERT_NEAR(this->difVec_.norm(),0.0,1e-10);
+  ASSERT_NEAR((front.cov_-this->testFilter2_.front_.cov_).norm(),0.0,1e-10);
+  this->testFilter_.stopSafeThread();
+}
+
+// Test lazy allocation of the sigma points and memory accounting
+TYPED_TEST(FilterBaseTest, memoryFootprint) {
+  std::map<std::string,size_t> footprint = this->testFilter_.memoryFootprint();
+  ASSERT_TRUE(footprint.count("update1") > 0);
+  ASSERT_TRUE(footprint["total"] > footprint["safe"]);
+  this->testFilter_.addPredictionMeas(this->testPredictionMeas_,0.1);
+  this->testFilter_.template addUpdateMeas<0>(this->testUpdateMeas_,0.1);
+  this->testFilter_.updateSafe();
+  ASSERT_TRUE(!this->testFilter_.mPrediction_.workspace_.stateSigmaPoints_.isAllocated());
+  ASSERT_TRUE(!std::get<0>(this->testFilter_.mUpdates_).innSigmaPoints_.isAllocated());
+  ASSERT_EQ(this->testFilter_.memoryFootprint()["prediction"],footprint["prediction"]);
+  this->testFilter_.safe_.mode_ = LWF::ModeUKF;
+  this->testFilter_.addPredictionMeas(this->testPredictionMeas_,0.2);
+  this->testFilter_.template addUpdateMeas<0>(this->testUpdateMeas_,0.2);
+  this->testFilter_.updateSafe();
+  ASSERT_TRUE(this->testFilter_.mPrediction_.workspace_.stateSigmaPoints_.isAllocated());
+  ASSERT_TRUE(std::get<0>(this->testFilter_.mUpdates_).innSigmaPoints_.isAllocated());
+  ASSERT_TRUE(this->testFilter_.memoryFootprint()["prediction"] > footprint["prediction"]);
+  ASSERT_EQ(this->testFilter_.memoryFootprint()["safe"],footprint["safe"]); // The workspace is not part of the filter state
+}
+
+// Test lazy front propagation (requestFront/getFront) and skipping of redundant safe updates
+TYPED_TEST(FilterBaseTest, lazyFront) {
+  for(unsigned int i=1;i<=4;i++){
+    this->testFilter_.addPredictionMeas(this->testPredictionMeas_,i*0.1);
+    this->testFilter2_.addPredictionMeas(this->testPredictionMeas_,i*0.1);
+  }
+  this->testFilter_.template addUpdateMeas<0>(this->testUpdateMeas_,0.1);
+  this->testFilter2_.template addUpdateMeas<0>(this->testUpdateMeas_,0.1);
+  this->testFilter_.requestFront(0.3);
+  ASSERT_EQ(this->testFilter_.front_.t_,0.0);
+  this->testFilter2_.updateFront(0.3);
+  ASSERT_EQ(this->testFilter_.getFront().t_,0.3);
+  this->testFilter_.front_.state_.boxMinus(this->testFilter2_.front_.state_,this->difVec_);
+  ASSERT_NEAR(this->difVec_.norm(),0.0,1e-10);
+
+  // Nothing new: neither safe nor front are propagated again
+  this->testFilter_.logCountRegPre_ = 99;
+  this->testFilter_.getFront();
+  this->testFilter_.updateSafe();
+  ASSERT_EQ(this->testFilter_.logCountRegPre_,99);
+
+  // Late measurement invalidates the front
+  this->testFilter_.template addUpdateMeas<0>(this->testUpdateMeas_,0.2);
+  this->testFilter2_.template addUpdateMeas<0>(this->testUpdateMeas_,0.2);
+  this->testFilter2_.updateFront(0.3);
+  ASSERT_EQ(this->testFilter_.getFront().t_,0.3);
+  this->testFilter_.front_.state_.boxMinus(this->testFilter2_.front_.state_,this->difVec_);
+  ASSERT_NEAR(this->difVec_.norm(),0.0,1e-10);
+}
+
+// Test concurrent measurement ingestion through the input queues
+TYPED_TEST(FilterBaseTest, pushMeas) {
+  std::vector<std::thread> threads;
+  std::atomic<int> failedPushes(0);
+  for(unsigned int j=0;j<4;j++){
+    threads.emplace_back([this,j,&failedPushes](){
+      for(unsigned int k=0;k<50;k++){
+        const double t = 0.1+0.001*(4*k+j);
+        if(!this->testFilter_.pushPredictionMeas(this->testPredictionMeas_,t)) failedPushes++;
+        if(!this->testFilter_.template pushUpdateMeas<0>(this->testUpdateMeas_,t)) failedPushes++;
+      }
+    });
+  }
+  for(auto& thread : threads){
+    thread.join();
+  }
+  ASSERT_EQ(failedPushes.load(),0);
+  ASSERT_EQ(this->testFilter_.predictionTimeline_.measMap_.size(),0);
+  this->testFilter_.drainInputQueues();
+  ASSERT_EQ(this->testFilter_.predictionTimeline_.measMap_.size(),200);
+  ASSERT_EQ(std::get<0>(this->testFilter_.updateTimelineTuple_).measMap_.size(),200);
+  ASSERT_EQ(this->testFilter_.eventIndex_.size(),200);
+
+  // Shared and moved measurements are enqueued without copy
+  auto predictionMeas = this->testFilter_.predictionTimeline_.makeMeasPtr(this->testPredictionMeas_);
+  auto updateMeas = std::get<0>(this->testFilter_.updateTimelineTuple_).makeMeasPtr(this->testUpdateMeas_);
+  ASSERT_TRUE(this->testFilter_.pushPredictionMeas(predictionMeas,0.5));
+  ASSERT_TRUE(this->testFilter_.template pushUpdateMeas<0>(updateMeas,0.5));
+  typename TestFixture::mtPredictionMeas meas = this->testPredictionMeas_;
+  ASSERT_TRUE(this->testFilter_.pushPredictionMeas(std::move(meas),0.6));
+  this->testFilter_.drainInputQueues();
+  ASSERT_EQ(this->testFilter_.predictionTimeline_.measMap_.at(0.5).get(),predictionMeas.get());
+  ASSERT_EQ(std::get<0>(this->testFilter_.updateTimelineTuple_).measMap_.at(0.5).get(),updateMeas.get());
+  ASSERT_EQ(this->testFilter_.predictionTimeline_.measMap_.size(),202);
+
+  // Configurable queue capacity
+  this->testFilter2_.predictionTimeline_.inputQueue_.setCapacity(5);
+  ASSERT_EQ(this->testFilter2_.predictionTimeline_.inputQueue_.capacity(),8u);
+  for(unsigned int k=0;k<8;k++){
+    ASSERT_TRUE(this->testFilter2_.pushPredictionMeas(this->testPredictionMeas_,0.1*(k+1)));
+  }
+  ASSERT_FALSE(this->testFilter2_.pushPredictionMeas(this->testPredictionMeas_,0.9));
+  this->testFilter2_.startSafeThread();
+  this->testFilter2_.stopSafeThread();
+  ASSERT_EQ(this->testFilter2_.frontPredictionTimeline_.inputQueue_.capacity(),8u);
+
+  // A full front prediction queue of the safe thread is reported as well (only drained by predictFront)
+  this->testFilter2_.startSafeThread();
+  for(unsigned int k=0;k<8;k++){
+    ASSERT_TRUE(this->testFilter2_.pushPredictionMeas(this->testPredictionMeas_,1.0+0.1*k));
+  }
+  for(int i=0;i<5000 && !this->testFilter2_.predictionTimeline_.inputQueue_.empty();i++){ // Drained by the safe thread
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_TRUE(this->testFilter2_.predictionTimeline_.inputQueue_.empty());
+  ASSERT_FALSE(this->testFilter2_.pushPredictionMeas(this->testPredictionMeas_,1.8));
+  this->testFilter2_.stopSafeThread();
+}
+
+// Test merged event index over the update timelines
+TYPED_TEST(FilterBaseTest, eventIndex) {
+  this->testFilter_.template addUpdateMeas<0>(this->testUpdateMeas_,0.3);
+  this->testFilter_.template addUpdateMeas<1>(this->testUpdateMeas_,0.2);
+  this->testFilter_.template addUpdateMeas<1>(this->testUpdateMeas_,0.3);
+  this->testFilter_.template addUpdateMeas<0>(this->testUpdateMeas_,0.1); // Out-of-order
+  ASSERT_EQ(this->testFilter_.eventIndex_.size(),3);
+  ASSERT_EQ(this->testFilter_.eventIndex_.at(0.1),1u);
+  ASSERT_EQ(this->testFilter_.eventIndex_.at(0.2),2u);
+  ASSERT_EQ(this->testFilter_.eventIndex_.at(0.3),3u);
+  for(unsigned int i=1;i<=4;i++){
+    this->testFilter_.addPredictionMeas(this->testPredictionMeas_,i*0.1);
+  }
+  this->testFilter_.updateSafe();
+  ASSERT_EQ(this->testFilter_.safe_.t_,0.3);
+  ASSERT_EQ(this->testFilter_.logCountRegUpd_,4);
+  ASSERT_EQ(this->testFilter_.eventIndex_.size(),0);
+
+  // Measurements dropped by a full timeline get no event
+  std::get<0>(this->testFilter_.updateTimelineTuple_).maxSize_ = 2;
+  ASSERT_TRUE(this->testFilter_.template addUpdateMeas<0>(this->testUpdateMeas_,0.5));
+  ASSERT_TRUE(this->testFilter_.template addUpdateMeas<0>(this->testUpdateMeas_,0.6));
+  ASSERT_FALSE(this->testFilter_.template addUpdateMeas<0>(this->testUpdateMeas_,0.4));
+  ASSERT_EQ(this->testFilter_.eventIndex_.size(),2);
+  ASSERT_EQ(this->testFilter_.eventIndex_.count(0.4),0);
+}
+
 // Test updateFront
 TYPED_TEST(FilterBaseTest, updateFront) {
   this->testFilter_.addPredictionMeas(this->testPredictionMeas_,0.1);
@@ -469,6 +1176,219 @@ TYPED_TEST(FilterBaseTest, highlevel3) {
   ASSERT_NEAR((this->testFilter_.safe_.cov_-this->testFilterState_.cov_).norm(),0.0,1e-6);
 }
 
+// Test joint update of different update types with measurements at the same time
+TYPED_TEST(FilterBaseTest, jointUpdate) {
+  typedef typename TestFixture::mtPredictionExample mtPredictionExample;
+  typedef typename TestFixture::mtUpdateExample mtUpdateExample;
+  LWF::FilterBase<mtPredictionExample,mtUpdateExample,mtUpdateExample> jointFilter;
+  const int jointInnovationDim = jointFilter.jointInnovationDim_;
+  ASSERT_EQ(jointInnovationDim,2*TestFixture::mtInnovation::D_);
+  jointFilter.useJointUpdates_ = true;
+  jointFilter.init_.state_ = this->testFilterState_.state_;
+  jointFilter.init_.cov_ = this->testFilterState_.cov_;
+  jointFilter.reset();
+  this->testFilterState_.t_ = 0.0;
+  jointFilter.addPredictionMeas(this->testPredictionMeas_,0.1);
+  jointFilter.template addUpdateMeas<0>(this->testUpdateMeas_,0.1);
+  jointFilter.template addUpdateMeas<1>(this->testUpdateMeas_,0.1);
+  jointFilter.updateSafe();
+  ASSERT_EQ(jointFilter.logCountJoiUpd_,1u);
+  ASSERT_EQ(jointFilter.logCountComUpd_,0u);
+  ASSERT_EQ(jointFilter.logCountRegUpd_,0u);
+  ASSERT_EQ(jointFilter.jointH_.rows(),jointInnovationDim);
+
+  // Equivalent to a stacked update of both measurements
+  std::vector<typename TestFixture::mtUpdateMeas,Eigen::aligned_allocator<typename TestFixture::mtUpdateMeas>> measVec(2,this->testUpdateMeas_);
+  jointFilter.mPrediction_.performPrediction(this->testFilterState_,this->testPredictionMeas_,0.1);
+  std::get<0>(jointFilter.mUpdates_).performUpdateBatch(this->testFilterState_,measVec);
+  jointFilter.safe_.state_.boxMinus(this->testFilterState_.state_,this->difVec_);
+  ASSERT_NEAR(this->difVec_.norm(),0.0,1e-6);
+  ASSERT_NEAR((jointFilter.safe_.cov_-this->testFilterState_.cov_).norm(),0.0,1e-6);
+
+  // Each update type holds its slices of the joint system for postprocessing
+  const int dI = TestFixture::mtInnovation::D_;
+  const mtUpdateExample& batchUpdate = std::get<0>(jointFilter.mUpdates_);
+  ASSERT_NEAR((std::get<0>(jointFilter.mUpdates_).Py_-batchUpdate.batchPy_.topLeftCorner(dI,dI)).norm(),0.0,1e-6);
+  ASSERT_NEAR((std::get<1>(jointFilter.mUpdates_).Py_-batchUpdate.batchPy_.bottomRightCorner(dI,dI)).norm(),0.0,1e-6);
+  ASSERT_NEAR((std::get<0>(jointFilter.mUpdates_).K_-batchUpdate.batchK_.leftCols(dI)).norm(),0.0,1e-6);
+  ASSERT_NEAR((std::get<1>(jointFilter.mUpdates_).K_-batchUpdate.batchK_.rightCols(dI)).norm(),0.0,1e-6);
+  const Eigen::MatrixXd batchPyinv = batchUpdate.batchPy_.inverse();
+  ASSERT_NEAR((std::get<1>(jointFilter.mUpdates_).Pyinv_-batchPyinv.bottomRightCorner(dI,dI)).norm(),0.0,1e-4);
+
+  // Only the update types with a measurement are stacked
+  LWF::FilterBase<mtPredictionExample,mtUpdateExample,mtUpdateExample,mtUpdateExample> jointFilter3;
+  jointFilter3.useJointUpdates_ = true;
+  jointFilter3.init_.state_ = jointFilter.init_.state_;
+  jointFilter3.init_.cov_ = jointFilter.init_.cov_;
+  jointFilter3.reset();
+  std::get<1>(jointFilter3.updateTimelineTuple_).maxWaitTime_ = 0.0; // No measurement of the second type
+  jointFilter3.invalidateWatermark();
+  jointFilter3.addPredictionMeas(this->testPredictionMeas_,0.1);
+  jointFilter3.template addUpdateMeas<0>(this->testUpdateMeas_,0.1);
+  jointFilter3.template addUpdateMeas<2>(this->testUpdateMeas_,0.1);
+  jointFilter3.updateSafe();
+  ASSERT_EQ(jointFilter3.logCountJoiUpd_,1u);
+  ASSERT_EQ(jointFilter3.jointH_.rows(),2*dI);
+  jointFilter3.safe_.state_.boxMinus(jointFilter.safe_.state_,this->difVec_);
+  ASSERT_NEAR(this->difVec_.norm(),0.0,1e-6);
+  ASSERT_NEAR((jointFilter3.safe_.cov_-jointFilter.safe_.cov_).norm(),0.0,1e-6);
+}
+
+// Update whose measurement is replaced during (asynchronous) preprocessing
+template<typename UpdateExample>
+class AsyncUpdateExample: public UpdateExample{
+ public:
+  typename UpdateExample::mtMeas target_;
+  void preProcessMeas(typename UpdateExample::mtMeas& meas, const typename UpdateExample::mtFilterState& prior) const{
+    meas = target_;
+  }
+};
+
+// Test asynchronous preprocessing
+TYPED_TEST(FilterBaseTest, asyncPreProcessing) {
+  typedef typename TestFixture::mtPredictionExample mtPredictionExample;
+  typedef typename TestFixture::mtUpdateExample mtUpdateExample;
+  LWF::FilterBase<mtPredictionExample,AsyncUpdateExample<mtUpdateExample>> asyncFilter;
+  LWF::FilterBase<mtPredictionExample,mtUpdateExample> filter;
+  asyncFilter.useAsyncPreProcessing_ = true;
+  asyncFilter.numPreProcessingThreads_ = 2;
+  std::get<0>(asyncFilter.mUpdates_).target_ = this->testUpdateMeas_;
+  typename TestFixture::mtUpdateMeas dummyMeas;
+  dummyMeas.setIdentity();
+  for(int i=1;i<=5;i++){
+    asyncFilter.addPredictionMeas(this->testPredictionMeas_,0.1*i);
+    asyncFilter.template addUpdateMeas<0>(dummyMeas,0.1*i);
+    filter.addPredictionMeas(this->testPredictionMeas_,0.1*i);
+    filter.template addUpdateMeas<0>(this->testUpdateMeas_,0.1*i);
+  }
+  ASSERT_EQ(asyncFilter.preProcessingPool_.getNumThreads(),2u);
+  ASSERT_EQ(asyncFilter.preProcessingPrior_->t_,asyncFilter.front_.t_);
+  asyncFilter.updateSafe();
+  filter.updateSafe();
+  ASSERT_EQ(asyncFilter.safe_.t_,filter.safe_.t_);
+  asyncFilter.safe_.state_.boxMinus(filter.safe_.state_,this->difVec_);
+  ASSERT_NEAR(this->difVec_.norm(),0.0,1e-10);
+  ASSERT_NEAR((asyncFilter.safe_.cov_-filter.safe_.cov_).norm(),0.0,1e-10);
+
+  // The pool shrinks, negative thread numbers run the preprocessing inline
+  asyncFilter.numPreProcessingThreads_ = 1;
+  asyncFilter.addPredictionMeas(this->testPredictionMeas_,0.6);
+  asyncFilter.template addUpdateMeas<0>(dummyMeas,0.6);
+  ASSERT_EQ(asyncFilter.preProcessingPool_.getNumThreads(),1u);
+  asyncFilter.numPreProcessingThreads_ = -1;
+  asyncFilter.addPredictionMeas(this->testPredictionMeas_,0.7);
+  asyncFilter.template addUpdateMeas<0>(dummyMeas,0.7);
+  ASSERT_EQ(asyncFilter.preProcessingPool_.getNumThreads(),0u);
+  ASSERT_EQ(asyncFilter.numPreProcessingThreads_,0);
+  filter.addPredictionMeas(this->testPredictionMeas_,0.6);
+  filter.template addUpdateMeas<0>(this->testUpdateMeas_,0.6);
+  filter.addPredictionMeas(this->testPredictionMeas_,0.7);
+  filter.template addUpdateMeas<0>(this->testUpdateMeas_,0.7);
+  asyncFilter.updateSafe();
+  filter.updateSafe();
+  ASSERT_EQ(asyncFilter.safe_.t_,filter.safe_.t_);
+  asyncFilter.safe_.state_.boxMinus(filter.safe_.state_,this->difVec_);
+  ASSERT_NEAR(this->difVec_.norm(),0.0,1e-10);
+
+  // A measurement reduced right away by a full timeline is not indexed and not preprocessed
+  asyncFilter.numPreProcessingThreads_ = 1;
+  std::get<0>(asyncFilter.updateTimelineTuple_).maxSize_ = 2;
+  std::get<0>(asyncFilter.updateTimelineTuple_).capacityPolicy_ = LWF::PolicyDecimate;
+  ASSERT_TRUE(asyncFilter.template addUpdateMeas<0>(dummyMeas,0.8));
+  ASSERT_TRUE(asyncFilter.template addUpdateMeas<0>(dummyMeas,0.9));
+  ASSERT_EQ(std::get<0>(asyncFilter.updateTimelineTuple_).measMap_.size(),2);
+  const unsigned int countDecimated = std::get<0>(asyncFilter.updateTimelineTuple_).countDecimated_;
+  ASSERT_FALSE(asyncFilter.template addUpdateMeas<0>(dummyMeas,0.75));
+  ASSERT_EQ(asyncFilter.eventIndex_.count(0.75),0);
+  ASSERT_EQ(std::get<0>(asyncFilter.updateTimelineTuple_).countDecimated_,countDecimated+1);
+}
+
+// Linear example models on a filter state with integer nanosecond time stamps
+namespace Nanoseconds{
+class FilterState: public LWF::FilterState<Linear::State,Linear::PredictionMeas,Linear::PredictionNoise,0,int64_t>{
+ public:
+  virtual ~FilterState(){};
+};
+class PredictionExample: public LWF::Prediction<FilterState>{
+ public:
+  PredictionExample(){
+    disablePreAndPostProcessingWarning_ = true;
+  };
+  void evalPrediction(mtState& output, const mtState& state, const mtNoise& noise, double dt) const{
+    output.get<mtState::POS>() = state.get<mtState::POS>()+dt*state.get<mtState::VEL>()+noise.get<mtNoise::VEL>()*sqrt(dt);
+    output.get<mtState::VEL>() = state.get<mtState::VEL>()+dt*meas_->get<mtMeas::ACC>()+noise.get<mtNoise::ACC>()*sqrt(dt);
+  }
+  void jacPreviousState(Eigen::MatrixXd& J, const mtState& state, double dt) const{
+    Linear::PredictionExample().jacPreviousState(J,state,dt);
+  }
+  void jacNoise(Eigen::MatrixXd& J, const mtState& state, double dt) const{
+    Linear::PredictionExample().jacNoise(J,state,dt);
+  }
+};
+class UpdateExample: public LWF::Update<Linear::Innovation,FilterState,Linear::UpdateMeas,Linear::UpdateNoise,Linear::OutlierDetectionExample,false>{
+ public:
+  UpdateExample(){
+    disablePreAndPostProcessingWarning_ = true;
+  };
+  void evalInnovation(mtInnovation& inn, const mtState& state, const mtNoise& noise) const{
+    inn.get<mtInnovation::POS>() = state.get<mtState::POS>()-meas_->get<mtMeas::POS>()+noise.get<mtNoise::POS>();
+    inn.get<mtInnovation::HEI>() = V3D(0,0,1).dot(state.get<mtState::POS>())-meas_->get<mtMeas::HEI>()+noise.get<mtNoise::HEI>();
+  }
+  void jacState(Eigen::MatrixXd& J, const mtState& state) const{
+    Linear::UpdateExample().jacState(J,state);
+  }
+  void jacNoise(Eigen::MatrixXd& J, const mtState& state) const{
+    Linear::UpdateExample().jacNoise(J,state);
+  }
+};
+}
+
+// Test integer nanosecond time stamps against the same filter in seconds
+TEST(FilterBaseTimeTest, nanoseconds) {
+  LWF::FilterBase<Nanoseconds::PredictionExample,Nanoseconds::UpdateExample> filterNs;
+  LWF::FilterBase<Linear::PredictionExample,Linear::UpdateExample> filter;
+  std::get<0>(filterNs.updateTimelineTuple_).maxWaitTime_ = 0.0;
+  std::get<0>(filter.updateTimelineTuple_).maxWaitTime_ = 0.0;
+  Linear::PredictionMeas predictionMeas;
+  Linear::UpdateMeas updateMeas;
+  unsigned int s = 1;
+  predictionMeas.setRandom(s);
+  updateMeas.setRandom(s);
+  const int64_t t0 = 1700000000000000000; // Epoch time stamps in nanoseconds are not representable as double
+  filterNs.reset(t0);
+  for(int i=1;i<=10;i++){
+    filterNs.addPredictionMeas(predictionMeas,t0+i*1000000);
+    filter.addPredictionMeas(predictionMeas,i*1e-3);
+  }
+  filterNs.addUpdateMeas<0>(updateMeas,t0+3000001); // Between two prediction measurements
+  filter.addUpdateMeas<0>(updateMeas,3.000001e-3);
+  filterNs.updateSafe();
+  filter.updateSafe();
+  ASSERT_EQ(filterNs.safe_.t_,t0+10000000);
+  ASSERT_EQ(filterNs.logCountRegUpd_,1);
+  ASSERT_EQ(std::get<0>(filterNs.updateTimelineTuple_).measMap_.size(),1);
+  ASSERT_NEAR(LWF::TimeTraits<int64_t>::toSeconds(filterNs.safe_.t_-t0),filter.safe_.t_,1e-12);
+  Linear::State::mtDifVec difVec;
+  filterNs.safe_.state_.boxMinus(filter.safe_.state_,difVec);
+  ASSERT_NEAR(difVec.norm(),0.0,1e-8);
+  ASSERT_NEAR((filterNs.safe_.cov_-filter.safe_.cov_).norm(),0.0,1e-8);
+
+  // Gaps which are not exactly representable in seconds do not shift the time stamp
+  LWF::FilterBase<Nanoseconds::PredictionExample,Nanoseconds::UpdateExample> filterGap;
+  std::get<0>(filterGap.updateTimelineTuple_).maxWaitTime_ = 0.0;
+  const int64_t gap = (int64_t(1) << 55) + 1;
+  filterGap.reset(t0);
+  filterGap.addPredictionMeas(predictionMeas,t0+gap);
+  filterGap.updateSafe();
+  ASSERT_EQ(filterGap.safe_.t_,t0+gap);
+  ASSERT_EQ(filterGap.logCountRegPre_,1);
+  ASSERT_EQ(filterGap.logCountBadPre_,0);
+  filterGap.addPredictionMeas(predictionMeas,t0+2*gap);
+  const int64_t times[3] = {t0+2*gap,t0+3*gap,t0+4*gap}; // Measurement, no-measurement and reused-Jacobian step
+  ASSERT_TRUE(filterGap.predictHorizon(times,3,true));
+  ASSERT_EQ(filterGap.horizonState_.t_,t0+4*gap);
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
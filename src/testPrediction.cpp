@@ -16,9 +16,9 @@ class PredictionModelTest : public ::testing::Test, public TestClass {
  protected:
   PredictionModelTest() {
     this->init(this->testState_,this->testUpdateMeas_,this->testPredictionMeas_);
-    this->measMap_[0.1] = this->testPredictionMeas_;
-    this->measMap_[0.2] = this->testPredictionMeas_;
-    this->measMap_[0.4] = this->testPredictionMeas_;
+    this->measMap_[0.1] = LWF::MeasurementTimeline<mtPredictionMeas>::makeMeasPtr(this->testPredictionMeas_);
+    this->measMap_[0.2] = LWF::MeasurementTimeline<mtPredictionMeas>::makeMeasPtr(this->testPredictionMeas_);
+    this->measMap_[0.4] = LWF::MeasurementTimeline<mtPredictionMeas>::makeMeasPtr(this->testPredictionMeas_);
   }
   virtual ~PredictionModelTest() {
   }
@@ -37,7 +37,7 @@ class PredictionModelTest : public ::testing::Test, public TestClass {
   mtPredictionMeas testPredictionMeas_;
   mtUpdateMeas testUpdateMeas_;
   const double dt_ = 0.1;
-  std::map<double,mtPredictionMeas> measMap_;
+  typename mtPredictionExample::mtMeasMap measMap_;
 };
 
 TYPED_TEST_CASE(PredictionModelTest, TestClasses);
@@ -53,7 +53,8 @@ TYPED_TEST(PredictionModelTest, FDjacobians) {
   Eigen::MatrixXd F((int)(TestFixture::mtPredictionExample::mtState::D_),(int)(TestFixture::mtPredictionExample::mtState::D_));
   Eigen::MatrixXd F_FD((int)(TestFixture::mtPredictionExample::mtState::D_),(int)(TestFixture::mtPredictionExample::mtState::D_));
   typename TestFixture::mtPredictionNoise n;
-  this->testPrediction_.meas_ = this->testPredictionMeas_;
+  n.setIdentity();
+  this->testPrediction_.meas_ = &this->testPredictionMeas_;
   this->testPrediction_.template jacInputFD<0>(F_FD,std::forward_as_tuple(this->testState_,n),this->dt_,0.0000001);
   this->testPrediction_.template jacInput<0>(F,std::forward_as_tuple(this->testState_,n),this->dt_);
   Eigen::MatrixXd Fn((int)(TestFixture::mtPredictionExample::mtState::D_),(int)(TestFixture::mtPredictionExample::mtNoise::D_));
@@ -80,7 +81,7 @@ TYPED_TEST(PredictionModelTest, performPredictionEKF) {
   typename TestFixture::mtPredictionExample::mtFilterState filterState;
   filterState.cov_.setIdentity();
   Eigen::MatrixXd F((int)(TestFixture::mtPredictionExample::mtState::D_),(int)(TestFixture::mtPredictionExample::mtState::D_));
-  this->testPrediction_.meas_ = this->testPredictionMeas_;
+  this->testPrediction_.meas_ = &this->testPredictionMeas_;
   this->testPrediction_.jacPreviousState(F,this->testState_,this->dt_);
   Eigen::MatrixXd Fn((int)(TestFixture::mtPredictionExample::mtState::D_),(int)(TestFixture::mtPredictionExample::mtNoise::D_));
   this->testPrediction_.jacNoise(Fn,this->testState_,this->dt_);
@@ -118,6 +119,7 @@ TYPED_TEST(PredictionModelTest, comparePredict) {
   filterState2.state_ = this->testState_;
   this->testPrediction_.performPredictionEKF(filterState1,this->testPredictionMeas_,this->dt_);
   this->testPrediction_.performPredictionUKF(filterState2,this->testPredictionMeas_,this->dt_);
+  ASSERT_TRUE(this->testPrediction_.meas_ == nullptr); // Not left pointing to the measurement
   typename TestFixture::mtPredictionExample::mtState::mtDifVec dif;
   filterState1.state_.boxMinus(filterState2.state_,dif);
   switch(TestFixture::id_){
@@ -147,15 +149,15 @@ TYPED_TEST(PredictionModelTest, predictMergedEKF) {
   typename TestFixture::mtPredictionExample::mtMeas::mtDifVec vec;
   typename TestFixture::mtPredictionExample::mtMeas::mtDifVec difVec;
   vec.setZero();
-  for(typename std::map<double,typename TestFixture::mtPredictionExample::mtMeas>::iterator it = next(this->measMap_.begin());it != this->measMap_.end();it++){
-    this->measMap_.begin()->second.boxMinus(it->second,difVec);
+  for(typename TestFixture::mtPredictionExample::mtMeasMap::iterator it = next(this->measMap_.begin());it != this->measMap_.end();it++){
+    this->measMap_.begin()->second->boxMinus(*it->second,difVec);
     vec = vec + difVec;
   }
   vec = vec/this->measMap_.size();
-  this->measMap_.begin()->second.boxPlus(vec,meanMeas);
+  this->measMap_.begin()->second->boxPlus(vec,meanMeas);
 
   Eigen::MatrixXd F((int)(TestFixture::mtPredictionExample::mtState::D_),(int)(TestFixture::mtPredictionExample::mtState::D_));
-  this->testPrediction_.meas_ = meanMeas;
+  this->testPrediction_.meas_ = &meanMeas;
   this->testPrediction_.jacPreviousState(F,this->testState_,dt);
   Eigen::MatrixXd Fn((int)(TestFixture::mtPredictionExample::mtState::D_),(int)(TestFixture::mtPredictionExample::mtNoise::D_));
   this->testPrediction_.jacNoise(Fn,this->testState_,dt);
@@ -163,8 +165,8 @@ TYPED_TEST(PredictionModelTest, predictMergedEKF) {
   filterState1.state_ = this->testState_;
   this->testPrediction_.predictMergedEKF(filterState1,this->measMap_.rbegin()->first,this->measMap_);
   filterState2.state_ = this->testState_;
-  for(typename std::map<double,typename TestFixture::mtPredictionExample::mtMeas>::iterator it = this->measMap_.begin();it != this->measMap_.end();it++){
-    this->testPrediction_.meas_ = it->second;
+  for(typename TestFixture::mtPredictionExample::mtMeasMap::iterator it = this->measMap_.begin();it != this->measMap_.end();it++){
+    this->testPrediction_.meas_ = it->second.get();
     this->testPrediction_.evalPredictionShort(filterState2.state_,filterState2.state_,it->first-t);
     t = it->first;
   }
@@ -200,20 +202,22 @@ TYPED_TEST(PredictionModelTest, predictMergedUKF) {
   typename TestFixture::mtPredictionExample::mtMeas::mtDifVec vec;
   typename TestFixture::mtPredictionExample::mtMeas::mtDifVec difVec;
   vec.setZero();
-  for(typename std::map<double,typename TestFixture::mtPredictionExample::mtMeas>::iterator it = next(this->measMap_.begin());it != this->measMap_.end();it++){
-    this->measMap_.begin()->second.boxMinus(it->second,difVec);
+  for(typename TestFixture::mtPredictionExample::mtMeasMap::iterator it = next(this->measMap_.begin());it != this->measMap_.end();it++){
+    this->measMap_.begin()->second->boxMinus(*it->second,difVec);
     vec = vec + difVec;
   }
   vec = vec/this->measMap_.size();
-  this->measMap_.begin()->second.boxPlus(vec,meanMeas);
+  this->measMap_.begin()->second->boxPlus(vec,meanMeas);
 
-  filterState1.stateSigmaPoints_.computeFromGaussian(filterState1.state_,filterState1.cov_);
-  for(unsigned int i=0;i<filterState1.stateSigmaPoints_.L_;i++){
-    this->testPrediction_.meas_ = meanMeas;
-    this->testPrediction_.evalPrediction(filterState1.stateSigmaPointsPre_(i),filterState1.stateSigmaPoints_(i),filterState1.stateSigmaPointsNoi_(i),dt);
+  typename TestFixture::mtPredictionExample::mtWorkspace workspace = this->testPrediction_.workspace_;
+  workspace.refreshNoiseSigmaPoints(this->testPrediction_.prenoiP_);
+  workspace.stateSigmaPoints_.computeFromGaussian(filterState1.state_,filterState1.cov_);
+  for(unsigned int i=0;i<workspace.stateSigmaPoints_.L_;i++){
+    this->testPrediction_.meas_ = &meanMeas;
+    this->testPrediction_.evalPrediction(workspace.stateSigmaPointsPre_(i),workspace.stateSigmaPoints_(i),workspace.stateSigmaPointsNoi_(i),dt);
   }
-  filterState1.stateSigmaPointsPre_.getMean(filterState1.state_);
-  filterState1.stateSigmaPointsPre_.getCovarianceMatrix(filterState1.state_,filterState1.cov_);
+  workspace.stateSigmaPointsPre_.getMean(filterState1.state_);
+  workspace.stateSigmaPointsPre_.getCovarianceMatrix(filterState1.state_,filterState1.cov_);
   this->testPrediction_.predictMergedUKF(filterState2,this->measMap_.rbegin()->first,this->measMap_);
   typename TestFixture::mtPredictionExample::mtState::mtDifVec dif;
   filterState1.state_.boxMinus(filterState2.state_,dif);
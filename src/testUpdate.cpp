@@ -67,7 +67,7 @@ TYPED_TEST(UpdateModelTest, constructors) {
 TYPED_TEST(UpdateModelTest, FDjacobians) {
   typename TestFixture::mtUpdateExample::mtNoise n;
   n.setIdentity();
-  this->testUpdate_.meas_ = this->testUpdateMeas_;
+  this->testUpdate_.meas_ = &this->testUpdateMeas_;
   Eigen::MatrixXd F((int)(TestFixture::mtUpdateExample::mtInnovation::D_),(int)(TestFixture::mtUpdateExample::mtState::D_));
   Eigen::MatrixXd F_FD((int)(TestFixture::mtUpdateExample::mtInnovation::D_),(int)(TestFixture::mtUpdateExample::mtState::D_));
   this->testUpdate_.template jacInputFD<0>(F_FD,std::forward_as_tuple(this->testState_,n),this->dt_,0.0000001);
@@ -93,7 +93,7 @@ TYPED_TEST(UpdateModelTest, FDjacobians) {
 
 // Test performUpdateEKF
 TYPED_TEST(UpdateModelTest, performUpdateEKF) {
-  this->testUpdate_.meas_ = this->testUpdateMeas_;
+  this->testUpdate_.meas_ = &this->testUpdateMeas_;
   typename TestFixture::mtUpdateExample::mtFilterState filterState;
   filterState.cov_.setIdentity();
   Eigen::MatrixXd H((int)(TestFixture::mtUpdateExample::mtInnovation::D_),(int)(TestFixture::mtUpdateExample::mtState::D_));
@@ -142,7 +142,7 @@ TYPED_TEST(UpdateModelTest, performUpdateEKF) {
 
 // Test updateEKFWithOutlier
 TYPED_TEST(UpdateModelTest, updateEKFWithOutlier) {
-  this->testUpdate_.meas_ = this->testUpdateMeas_;
+  this->testUpdate_.meas_ = &this->testUpdateMeas_;
   typename TestFixture::mtUpdateExample::mtFilterState filterState;
   filterState.cov_.setIdentity();
   Eigen::MatrixXd H((int)(TestFixture::mtUpdateExample::mtInnovation::D_),(int)(TestFixture::mtUpdateExample::mtState::D_));
@@ -511,7 +511,7 @@ TYPED_TEST(UpdateModelTest, performUpdateLEKF2) {
 
 // Test performUpdateLEKF3 (linearization point <> prediction, general)
 TYPED_TEST(UpdateModelTest, performUpdateLEKF3) {
-  this->testUpdate_.meas_ = this->testUpdateMeas_;
+  this->testUpdate_.meas_ = &this->testUpdateMeas_;
   // Linearization point
   typename TestFixture::mtUpdateExample::mtFilterState filterState;
   filterState.state_ = this->testState_;
@@ -606,7 +606,7 @@ TYPED_TEST(UpdateModelTest, performUpdateIEKF1) {
 
 // Test performUpdateIEKF2 (general test)
 TYPED_TEST(UpdateModelTest, performUpdateIEKF2) {
-  this->testUpdate_.meas_ = this->testUpdateMeas_;
+  this->testUpdate_.meas_ = &this->testUpdateMeas_;
   typename TestFixture::mtUpdateExample::mtFilterState filterState;
   // Linearization point
   typename TestFixture::mtUpdateExample::mtState linState;
@@ -671,6 +671,516 @@ TYPED_TEST(UpdateModelTest, performUpdateIEKF2) {
   }
 }
 
+// Test performUpdateIEKF3 (Jacobian freezing, Broyden update and adaptive termination)
+TYPED_TEST(UpdateModelTest, performUpdateIEKF3) {
+  typename TestFixture::mtUpdateExample::mtFilterState filterState1;
+  typename TestFixture::mtUpdateExample::mtFilterState filterState2;
+  filterState1.cov_.setIdentity();
+  filterState2.cov_ = filterState1.cov_;
+  filterState1.state_ = this->testState_;
+  filterState2.state_ = this->testState_;
+  this->testUpdate_.performUpdateIEKF(filterState1,this->testUpdateMeas_);
+  const unsigned int jacobianEvaluationCount = this->testUpdate_.jacobianEvaluationCount_;
+  this->testUpdate_.resetIterationStatistics();
+  this->testUpdate_.useJacobianFreezing_ = true;
+  this->testUpdate_.jacobianFreezingTh_ = 1e-3;
+  this->testUpdate_.useBroydenUpdate_ = true;
+  this->testUpdate_.useAdaptiveTermination_ = true;
+  this->testUpdate_.performUpdateIEKF(filterState2,this->testUpdateMeas_);
+  unsigned int runs = 0;
+  for(unsigned int i=0;i<this->testUpdate_.iterationHistogram_.size();i++){
+    runs += this->testUpdate_.iterationHistogram_[i];
+  }
+  ASSERT_EQ(runs,1u);
+  typename TestFixture::mtUpdateExample::mtState::mtDifVec dif;
+  filterState1.state_.boxMinus(filterState2.state_,dif);
+  switch(TestFixture::id_){
+    case 0:
+      ASSERT_LT(this->testUpdate_.jacobianEvaluationCount_,jacobianEvaluationCount);
+      ASSERT_NEAR(dif.norm(),0.0,1e-5);
+      ASSERT_NEAR((filterState1.cov_-filterState2.cov_).norm(),0.0,1e-5);
+      break;
+    case 1: // Linear, the Jacobian can be frozen after the first iteration without changing the result
+      ASSERT_EQ(this->testUpdate_.jacobianEvaluationCount_,jacobianEvaluationCount);
+      ASSERT_NEAR(dif.norm(),0.0,1e-10);
+      ASSERT_NEAR((filterState1.cov_-filterState2.cov_).norm(),0.0,1e-10);
+      filterState2.cov_.setIdentity();
+      filterState2.state_ = this->testState_;
+      this->testUpdate_.resetIterationStatistics();
+      this->testUpdate_.jacobianFreezingTh_ = 1e10;
+      this->testUpdate_.performUpdateIEKF(filterState2,this->testUpdateMeas_);
+      ASSERT_EQ(this->testUpdate_.jacobianEvaluationCount_,1u);
+      ASSERT_LT(this->testUpdate_.jacobianEvaluationCount_,jacobianEvaluationCount);
+      filterState1.state_.boxMinus(filterState2.state_,dif);
+      ASSERT_NEAR(dif.norm(),0.0,1e-10);
+      ASSERT_NEAR((filterState1.cov_-filterState2.cov_).norm(),0.0,1e-10);
+      break;
+    default:
+      ASSERT_LT(this->testUpdate_.jacobianEvaluationCount_,jacobianEvaluationCount);
+      ASSERT_NEAR(dif.norm(),0.0,1e-5);
+      ASSERT_NEAR((filterState1.cov_-filterState2.cov_).norm(),0.0,1e-5);
+      break;
+  }
+}
+
+// Update which counts the calls of its pre- and postprocessing
+template<typename UpdateExample>
+class HookCountingUpdateExample: public UpdateExample{
+ public:
+  int preProcessCount_ = 0;
+  int postProcessCount_ = 0;
+  int postProcessOutlierCount_ = 0;
+  void preProcess(typename UpdateExample::mtFilterState& filterState, const typename UpdateExample::mtMeas& meas, bool& isFinished){
+    isFinished = false;
+    preProcessCount_++;
+  }
+  void postProcess(typename UpdateExample::mtFilterState& filterState, const typename UpdateExample::mtMeas& meas,
+                   const typename UpdateExample::mtOutlierDetection& outlierDetection, bool& isFinished){
+    isFinished = true;
+    postProcessCount_++;
+    if(outlierDetection.isOutlier(0)) postProcessOutlierCount_++;
+  }
+};
+
+// Test performUpdateBatch (two identical measurements are equivalent to one with half the noise covariance)
+TYPED_TEST(UpdateModelTest, performUpdateBatch) {
+  typename TestFixture::mtUpdateExample::mtFilterState filterState1;
+  typename TestFixture::mtUpdateExample::mtFilterState filterState2;
+  filterState1.cov_.setIdentity();
+  filterState2.cov_ = filterState1.cov_;
+  filterState1.state_ = this->testState_;
+  filterState2.state_ = this->testState_;
+  std::vector<typename TestFixture::mtUpdateExample::mtMeas,Eigen::aligned_allocator<typename TestFixture::mtUpdateExample::mtMeas>> measVec(2,this->testUpdateMeas_);
+  this->testUpdate_.performUpdateBatch(filterState1,measVec);
+  this->testUpdate_.updnoiP_ *= 0.5;
+  this->testUpdate_.performUpdateEKF(filterState2,this->testUpdateMeas_);
+  filterState2.state_.fix();
+  typename TestFixture::mtUpdateExample::mtState::mtDifVec dif;
+  filterState1.state_.boxMinus(filterState2.state_,dif);
+  ASSERT_NEAR(dif.norm(),0.0,1e-6);
+  ASSERT_NEAR((filterState1.cov_-filterState2.cov_).norm(),0.0,1e-6);
+
+  // Per measurement outlier detection, the counts evolve as for sequential updates
+  HookCountingUpdateExample<typename TestFixture::mtUpdateExample> hookUpdate;
+  hookUpdate.outlierDetection_.setEnabledAll(true);
+  hookUpdate.outlierDetection_.getMahalTh(0) = -1.0;
+  this->testUpdate_.outlierDetection_.setEnabledAll(true);
+  this->testUpdate_.outlierDetection_.getMahalTh(0) = -1.0;
+  filterState1.cov_.setIdentity();
+  filterState2.cov_ = filterState1.cov_;
+  filterState1.state_ = this->testState_;
+  filterState2.state_ = this->testState_;
+  hookUpdate.performUpdateBatch(filterState1,measVec);
+  this->testUpdate_.performUpdateEKF(filterState2,this->testUpdateMeas_);
+  filterState2.state_.fix();
+  filterState1.state_.boxMinus(filterState2.state_,dif);
+  ASSERT_NEAR(dif.norm(),0.0,1e-6);
+  ASSERT_NEAR((filterState1.cov_-filterState2.cov_).norm(),0.0,1e-6);
+  ASSERT_EQ(hookUpdate.batchOutlierDetections_.size(),2u);
+  ASSERT_TRUE(hookUpdate.batchOutlierDetections_[0].isOutlier(0));
+  ASSERT_TRUE(hookUpdate.batchOutlierDetections_[1].isOutlier(0));
+  ASSERT_EQ(hookUpdate.batchOutlierDetections_[0].getCount(0),1u);
+  ASSERT_EQ(hookUpdate.batchOutlierDetections_[1].getCount(0),2u);
+  ASSERT_EQ(hookUpdate.outlierDetection_.getCount(0),2u);
+  ASSERT_EQ(hookUpdate.batchInlierMask_.count(),2*(TestFixture::mtUpdateExample::mtInnovation::D_-3));
+
+  // Pre- and postprocessing is called for every measurement
+  ASSERT_EQ(hookUpdate.preProcessCount_,2);
+  ASSERT_EQ(hookUpdate.postProcessCount_,2);
+  ASSERT_EQ(hookUpdate.postProcessOutlierCount_,2);
+}
+
+// Update with nuisance parameters which fully explain the first innovation block
+template<typename UpdateExample>
+class NuisanceUpdateExample: public UpdateExample{
+ public:
+  void jacNuisance(Eigen::MatrixXd& F, const typename UpdateExample::mtState& state) const{
+    F.setZero(UpdateExample::mtInnovation::D_,3);
+    F.template topRows<3>().setIdentity();
+  }
+};
+
+// Test performUpdateNullSpace (equivalent to rejecting the first innovation block as outlier)
+TYPED_TEST(UpdateModelTest, performUpdateNullSpace) {
+  NuisanceUpdateExample<typename TestFixture::mtUpdateExample> nuisanceUpdate;
+  nuisanceUpdate.useNullSpaceProjection_ = true;
+  typename TestFixture::mtUpdateExample::mtFilterState filterState1;
+  typename TestFixture::mtUpdateExample::mtFilterState filterState2;
+  filterState1.cov_.setIdentity();
+  filterState2.cov_ = filterState1.cov_;
+  filterState1.state_ = this->testState_;
+  filterState2.state_ = this->testState_;
+  nuisanceUpdate.performUpdate(filterState1,this->testUpdateMeas_);
+  this->testUpdate_.outlierDetection_.setEnabledAll(true);
+  this->testUpdate_.outlierDetection_.getMahalTh(0) = -1.0;
+  this->testUpdate_.performUpdateEKF(filterState2,this->testUpdateMeas_);
+  filterState2.state_.fix();
+  typename TestFixture::mtUpdateExample::mtState::mtDifVec dif;
+  filterState1.state_.boxMinus(filterState2.state_,dif);
+  ASSERT_NEAR(dif.norm(),0.0,1e-8);
+  ASSERT_NEAR((filterState1.cov_-filterState2.cov_).norm(),0.0,1e-8);
+
+  // Iterated version converges to IEKF solution of the reduced problem
+  filterState1.cov_.setIdentity();
+  filterState2.cov_ = filterState1.cov_;
+  filterState1.state_ = this->testState_;
+  filterState2.state_ = this->testState_;
+  filterState1.mode_ = LWF::ModeIEKF;
+  nuisanceUpdate.performUpdate(filterState1,this->testUpdateMeas_);
+  this->testUpdate_.performUpdateIEKF(filterState2,this->testUpdateMeas_);
+  filterState1.state_.boxMinus(filterState2.state_,dif);
+  ASSERT_NEAR(dif.norm(),0.0,1e-6);
+  ASSERT_NEAR((filterState1.cov_-filterState2.cov_).norm(),0.0,1e-6);
+
+  // Gating of the projected innovation
+  filterState1.cov_.setIdentity();
+  filterState1.state_ = this->testState_;
+  filterState1.mode_ = LWF::ModeEKF;
+  filterState2 = filterState1;
+  nuisanceUpdate.outlierDetection_.setEnabledAll(true);
+  nuisanceUpdate.nullSpaceOutlierFactor_ = -1.0;
+  nuisanceUpdate.performUpdate(filterState1,this->testUpdateMeas_);
+  ASSERT_TRUE(nuisanceUpdate.isNullSpaceOutlier_);
+  ASSERT_EQ(nuisanceUpdate.nullSpaceOutlierCount_,1u);
+  filterState1.state_.boxMinus(filterState2.state_,dif);
+  ASSERT_NEAR(dif.norm(),0.0,1e-10);
+  ASSERT_NEAR((filterState1.cov_-filterState2.cov_).norm(),0.0,1e-10);
+  nuisanceUpdate.nullSpaceOutlierFactor_ = 1e10;
+  nuisanceUpdate.performUpdate(filterState1,this->testUpdateMeas_);
+  ASSERT_FALSE(nuisanceUpdate.isNullSpaceOutlier_);
+  ASSERT_TRUE((filterState1.cov_-filterState2.cov_).norm() > 1e-6);
+}
+
+// Multi-view constraint: 20 observations of the position relative to a common landmark (nuisance parameters)
+class StackedInnovation: public LWF::State<LWF::VectorElement<60>>{
+ public:
+  StackedInnovation(){};
+  virtual ~StackedInnovation(){};
+};
+class StackedNuisanceUpdateExample: public LWF::Update<StackedInnovation,Linear::FilterState,StackedInnovation,StackedInnovation,LWF::OutlierDetection<LWF::ODEntry<0,3,20>>,false>{
+ public:
+  StackedNuisanceUpdateExample(){
+    disablePreAndPostProcessingWarning_ = true;
+  };
+  virtual ~StackedNuisanceUpdateExample(){};
+  void evalInnovation(mtInnovation& inn, const mtState& state, const mtNoise& noise) const{
+    for(int k=0;k<20;k++){
+      inn.get<0>().segment<3>(3*k) = state.get<Linear::State::POS>()-meas_->get<0>().segment<3>(3*k)+noise.get<0>().segment<3>(3*k);
+    }
+  }
+  void jacState(Eigen::MatrixXd& J, const mtState& state) const{
+    J.setZero();
+    for(int k=0;k<20;k++){
+      J.block<3,3>(3*k,mtState::getId<Linear::State::POS>()) = M3D::Identity();
+    }
+  }
+  void jacNoise(Eigen::MatrixXd& J, const mtState& state) const{
+    J.setIdentity();
+  }
+  void jacNuisance(Eigen::MatrixXd& F, const mtState& state) const{
+    F.resize(mtInnovation::D_,3);
+    for(int k=0;k<20;k++){
+      F.block<3,3>(3*k,0) = M3D::Identity();
+    }
+  }
+};
+
+// Test the gating of large projected innovations (57 dimensions, the quadratic fit of the block thresholds is negative there)
+TEST(UpdateNullSpaceTest, gatingOfLargeInnovation) {
+  StackedNuisanceUpdateExample update;
+  update.useNullSpaceProjection_ = true;
+  update.outlierDetection_.setEnabledAll(true);
+  Linear::FilterState filterState;
+  filterState.cov_.setIdentity();
+  filterState.cov_ *= 1e-4;
+  filterState.state_.setIdentity();
+  StackedInnovation meas;
+  for(int i=0;i<60;i++){
+    meas.get<0>()(i) = V3D(1.0,-2.0,0.5)(i%3) + 0.01*std::sin(1.3*i); // Landmark offset plus noise-level deviations
+  }
+  update.performUpdate(filterState,meas);
+  ASSERT_EQ(update.projInnVector_.size(),57);
+  ASSERT_FALSE(update.isNullSpaceOutlier_);
+  ASSERT_TRUE(update.nullSpaceMahalanobisDistance_ > 0.0);
+  ASSERT_NEAR(LWF::chiSquareQuantile95(57),75.62,0.05);
+
+  // Gross error in a single observation
+  meas.get<0>()(30) += 1.0;
+  update.performUpdate(filterState,meas);
+  ASSERT_TRUE(update.isNullSpaceOutlier_);
+  ASSERT_EQ(update.nullSpaceOutlierCount_,1u);
+}
+
+// Test QR compression of tall stacked innovations
+TYPED_TEST(UpdateModelTest, performUpdateCompressed) {
+  typename TestFixture::mtUpdateExample::mtFilterState filterState1;
+  typename TestFixture::mtUpdateExample::mtFilterState filterState2;
+  filterState1.cov_.setIdentity();
+  filterState2.cov_ = filterState1.cov_;
+  filterState1.state_ = this->testState_;
+  filterState2.state_ = this->testState_;
+  std::vector<typename TestFixture::mtUpdateExample::mtMeas,Eigen::aligned_allocator<typename TestFixture::mtUpdateExample::mtMeas>> measVec(3,this->testUpdateMeas_);
+  ASSERT_TRUE(measVec.size()*TestFixture::mtUpdateExample::mtInnovation::D_ > TestFixture::mtUpdateExample::mtState::D_);
+  this->testUpdate_.performUpdateBatch(filterState1,measVec);
+  this->testUpdate_.useQRCompression_ = true;
+  this->testUpdate_.performUpdateBatch(filterState2,measVec);
+  ASSERT_TRUE(this->testUpdate_.compH_.rows() == TestFixture::mtUpdateExample::mtState::D_);
+  typename TestFixture::mtUpdateExample::mtState::mtDifVec dif;
+  filterState1.state_.boxMinus(filterState2.state_,dif);
+  ASSERT_NEAR(dif.norm(),0.0,1e-8);
+  ASSERT_NEAR((filterState1.cov_-filterState2.cov_).norm(),0.0,1e-8);
+
+  // Correlated measurement noise
+  this->testUpdate_.updnoiP_ += 0.5*this->testUpdate_.updnoiP_.diagonal().minCoeff()*Eigen::MatrixXd::Ones(this->testUpdate_.updnoiP_.rows(),this->testUpdate_.updnoiP_.cols());
+  filterState1.cov_.setIdentity();
+  filterState2.cov_ = filterState1.cov_;
+  filterState1.state_ = this->testState_;
+  filterState2.state_ = this->testState_;
+  this->testUpdate_.useQRCompression_ = false;
+  this->testUpdate_.performUpdateBatch(filterState1,measVec);
+  this->testUpdate_.useQRCompression_ = true;
+  this->testUpdate_.performUpdateBatch(filterState2,measVec);
+  filterState1.state_.boxMinus(filterState2.state_,dif);
+  ASSERT_NEAR(dif.norm(),0.0,1e-8);
+  ASSERT_NEAR((filterState1.cov_-filterState2.cov_).norm(),0.0,1e-8);
+}
+
+// Test QR compression of a single tall innovation (block diagonal noise)
+TEST(UpdateCompressionTest, performUpdateEKFCompressed) {
+  StackedNuisanceUpdateExample update;
+  Linear::FilterState filterState1;
+  filterState1.cov_.setIdentity();
+  filterState1.state_.setIdentity();
+  Linear::FilterState filterState2 = filterState1;
+  StackedInnovation meas;
+  for(int i=0;i<60;i++){
+    meas.get<0>()(i) = 0.1*std::sin(1.3*i);
+  }
+  update.performUpdateEKF(filterState1,meas);
+  ASSERT_FALSE(update.isCompressedUpdate_);
+  update.useQRCompression_ = true;
+  update.performUpdateEKF(filterState2,meas);
+  ASSERT_TRUE(update.isCompressedUpdate_);
+  ASSERT_EQ(update.compNoise_.cols(),1);
+  Linear::State::mtDifVec dif;
+  filterState1.state_.boxMinus(filterState2.state_,dif);
+  ASSERT_NEAR(dif.norm(),0.0,1e-8);
+  ASSERT_NEAR((filterState1.cov_-filterState2.cov_).norm(),0.0,1e-8);
+
+  // Noise correlated within the observations
+  for(int k=0;k<20;k++){
+    update.updnoiP_.block<3,3>(3*k,3*k) += 0.5e-4*M3D::Ones();
+  }
+  update.compressionBlockSize_ = 3;
+  filterState1.cov_.setIdentity();
+  filterState1.state_.setIdentity();
+  filterState2 = filterState1;
+  update.useQRCompression_ = false;
+  update.performUpdateEKF(filterState1,meas);
+  update.useQRCompression_ = true;
+  update.performUpdateEKF(filterState2,meas);
+  ASSERT_TRUE(update.isCompressedUpdate_);
+  filterState1.state_.boxMinus(filterState2.state_,dif);
+  ASSERT_NEAR(dif.norm(),0.0,1e-8);
+  ASSERT_NEAR((filterState1.cov_-filterState2.cov_).norm(),0.0,1e-8);
+}
+
+// Test outlier compaction (removing outlier rows gives the same result as decoupling them)
+TYPED_TEST(UpdateModelTest, performUpdateEKFCompacted) {
+  typename TestFixture::mtUpdateExample::mtFilterState filterState1;
+  typename TestFixture::mtUpdateExample::mtFilterState filterState2;
+  filterState1.cov_.setIdentity();
+  filterState2.cov_ = filterState1.cov_;
+  filterState1.state_ = this->testState_;
+  filterState2.state_ = this->testState_;
+  this->testUpdate_.outlierDetection_.setEnabledAll(true);
+  this->testUpdate_.outlierDetection_.getMahalTh(0) = -1.0;
+  this->testUpdate_.performUpdateEKF(filterState1,this->testUpdateMeas_);
+  const Eigen::MatrixXd K = this->testUpdate_.K_;
+  const Eigen::MatrixXd Pyinv = this->testUpdate_.Pyinv_;
+  this->testUpdate_.useOutlierCompaction_ = true;
+  this->testUpdate_.performUpdateEKF(filterState2,this->testUpdateMeas_);
+  ASSERT_TRUE(this->testUpdate_.outlierDetection_.isOutlier(0));
+  ASSERT_EQ(this->testUpdate_.inlierMask_.count(),TestFixture::mtUpdateExample::mtInnovation::D_-3);
+  typename TestFixture::mtUpdateExample::mtState::mtDifVec dif;
+  filterState1.state_.boxMinus(filterState2.state_,dif);
+  ASSERT_NEAR(dif.norm(),0.0,1e-10);
+  ASSERT_NEAR((filterState1.cov_-filterState2.cov_).norm(),0.0,1e-10);
+  ASSERT_NEAR((K-this->testUpdate_.K_).norm(),0.0,1e-10);
+  ASSERT_NEAR((Pyinv-this->testUpdate_.Pyinv_).norm(),0.0,1e-8);
+
+  // Special linearization point, the innovation is left untouched
+  filterState1.cov_.setIdentity();
+  filterState1.state_ = this->testState_;
+  filterState1.difVecLin_.setConstant(0.01);
+  filterState2 = filterState1;
+  this->testUpdate_.useSpecialLinearizationPoint_ = true;
+  this->testUpdate_.useOutlierCompaction_ = false;
+  this->testUpdate_.performUpdateEKF(filterState1,this->testUpdateMeas_);
+  const typename TestFixture::mtUpdateExample::mtInnovation::mtDifVec innVector = this->testUpdate_.innVector_;
+  this->testUpdate_.useOutlierCompaction_ = true;
+  this->testUpdate_.performUpdateEKF(filterState2,this->testUpdateMeas_);
+  ASSERT_NEAR((innVector-this->testUpdate_.innVector_).norm(),0.0,1e-10);
+  filterState1.state_.boxMinus(filterState2.state_,dif);
+  ASSERT_NEAR(dif.norm(),0.0,1e-10);
+  ASSERT_NEAR((filterState1.cov_-filterState2.cov_).norm(),0.0,1e-10);
+}
+
+// Test pre-gating
+TYPED_TEST(UpdateModelTest, preGating) {
+  typename TestFixture::mtUpdateExample::mtFilterState filterState1;
+  typename TestFixture::mtUpdateExample::mtFilterState filterState2;
+  filterState1.cov_.setIdentity();
+  filterState1.state_ = this->testState_;
+  this->testUpdate_.usePreGating_ = true;
+  ASSERT_FALSE(this->testUpdate_.preGate(filterState1,this->testUpdateMeas_)); // No cached covariance yet
+  this->testUpdate_.performUpdate(filterState1,this->testUpdateMeas_);
+  ASSERT_TRUE(this->testUpdate_.hasPreGatingPyDiag_);
+  filterState2 = filterState1;
+
+  // Only enabled outlier detection blocks are gated, not with a special linearization point
+  this->testUpdate_.preGatingFactor_ = -1.0;
+  ASSERT_FALSE(this->testUpdate_.preGate(filterState2,this->testUpdateMeas_));
+  this->testUpdate_.outlierDetection_.setEnabledAll(true);
+  this->testUpdate_.useSpecialLinearizationPoint_ = true;
+  ASSERT_FALSE(this->testUpdate_.preGate(filterState2,this->testUpdateMeas_));
+  this->testUpdate_.useSpecialLinearizationPoint_ = false;
+  this->testUpdate_.resetPreGatingStatistics();
+
+  // A rejected block is an outlier of the update, the remaining rows are fused (same as a failed Mahalanobis check)
+  typename TestFixture::mtUpdateExample::mtFilterState filterState3 = filterState1;
+  this->testUpdate_.performUpdate(filterState2,this->testUpdateMeas_);
+  ASSERT_FALSE(this->testUpdate_.isPreGated_);
+  ASSERT_TRUE(this->testUpdate_.outlierDetection_.isOutlier(0));
+  ASSERT_EQ(this->testUpdate_.preGatingHitCount_,1u);
+  const double mahalanobisTh = this->testUpdate_.outlierDetection_.getMahalTh(0);
+  this->testUpdate_.usePreGating_ = false;
+  this->testUpdate_.outlierDetection_.getMahalTh(0) = -1.0;
+  this->testUpdate_.performUpdate(filterState3,this->testUpdateMeas_);
+  typename TestFixture::mtUpdateExample::mtState::mtDifVec dif;
+  filterState2.state_.boxMinus(filterState3.state_,dif);
+  ASSERT_NEAR(dif.norm(),0.0,1e-10);
+  ASSERT_NEAR((filterState2.cov_-filterState3.cov_).norm(),0.0,1e-10);
+  ASSERT_TRUE((filterState1.cov_-filterState2.cov_).norm() > 1e-6);
+  this->testUpdate_.usePreGating_ = true;
+  this->testUpdate_.outlierDetection_.getMahalTh(0) = mahalanobisTh;
+
+  // Accepted measurement is processed normally
+  this->testUpdate_.preGatingFactor_ = 1e10;
+  this->testUpdate_.performUpdate(filterState2,this->testUpdateMeas_);
+  ASSERT_FALSE(this->testUpdate_.isPreGated_);
+  ASSERT_EQ(this->testUpdate_.preGatingCheckCount_,2u);
+  ASSERT_NEAR(this->testUpdate_.preGatingHitRate_,0.5,1e-10);
+}
+
+// Test pre-gating of a measurement whose rows are all covered by rejected blocks
+TEST(UpdatePreGatingTest, dropMeasurement) {
+  StackedNuisanceUpdateExample update;
+  update.usePreGating_ = true;
+  update.outlierDetection_.setEnabledAll(true);
+  Linear::FilterState filterState1;
+  filterState1.cov_.setIdentity();
+  filterState1.state_.setIdentity();
+  StackedInnovation meas;
+  meas.get<0>().setConstant(0.1);
+  update.performUpdate(filterState1,meas);
+  Linear::FilterState filterState2 = filterState1;
+  update.preGatingFactor_ = -1.0;
+  update.performUpdate(filterState2,meas);
+  ASSERT_TRUE(update.isPreGated_);
+  for(unsigned int i=0;i<20;i++){
+    ASSERT_TRUE(update.outlierDetection_.isOutlier(i));
+    ASSERT_EQ(update.outlierDetection_.getCount(i),1u);
+  }
+  Linear::State::mtDifVec dif;
+  filterState1.state_.boxMinus(filterState2.state_,dif);
+  ASSERT_NEAR(dif.norm(),0.0,1e-10);
+  ASSERT_NEAR((filterState1.cov_-filterState2.cov_).norm(),0.0,1e-10);
+}
+
+// Test individual and adaptive filtering mode
+TYPED_TEST(UpdateModelTest, individualMode) {
+  typename TestFixture::mtUpdateExample::mtFilterState filterState1;
+  typename TestFixture::mtUpdateExample::mtFilterState filterState2;
+  typename TestFixture::mtUpdateExample::mtState::mtDifVec dif;
+  filterState1.cov_.setIdentity();
+  filterState1.state_ = this->testState_;
+  filterState1.mode_ = LWF::ModeEKF;
+  filterState2 = filterState1;
+  this->testUpdate_.performUpdateIEKF(filterState1,this->testUpdateMeas_);
+  filterState1.state_.fix();
+  this->testUpdate_.useIndividualMode_ = true;
+  this->testUpdate_.mode_ = LWF::ModeIEKF;
+  this->testUpdate_.performUpdate(filterState2,this->testUpdateMeas_);
+  filterState1.state_.boxMinus(filterState2.state_,dif);
+  ASSERT_NEAR(dif.norm(),0.0,1e-10);
+  ASSERT_NEAR((filterState1.cov_-filterState2.cov_).norm(),0.0,1e-10);
+
+  // Adaptive escalation from EKF to IEKF
+  ASSERT_EQ(this->testUpdate_.adaptiveModeTh_,LWF::chiSquareQuantile95(TestFixture::mtUpdateExample::mtInnovation::D_));
+  this->testUpdate_.mode_ = LWF::ModeEKF;
+  this->testUpdate_.useAdaptiveMode_ = true;
+  this->testUpdate_.adaptiveModeTh_ = -1.0;
+  filterState2.cov_.setIdentity();
+  filterState2.state_ = this->testState_;
+  this->testUpdate_.performUpdate(filterState2,this->testUpdateMeas_);
+  ASSERT_EQ(this->testUpdate_.adaptiveEscalationCount_,1u);
+  filterState1.state_.boxMinus(filterState2.state_,dif);
+  ASSERT_NEAR(dif.norm(),0.0,1e-10);
+  ASSERT_NEAR((filterState1.cov_-filterState2.cov_).norm(),0.0,1e-10);
+
+  // No escalation below threshold
+  this->testUpdate_.adaptiveModeTh_ = 1e10;
+  filterState1.cov_.setIdentity();
+  filterState1.state_ = this->testState_;
+  filterState2 = filterState1;
+  this->testUpdate_.performUpdateEKF(filterState1,this->testUpdateMeas_);
+  filterState1.state_.fix();
+  this->testUpdate_.performUpdate(filterState2,this->testUpdateMeas_);
+  ASSERT_EQ(this->testUpdate_.adaptiveEscalationCount_,1u);
+  filterState1.state_.boxMinus(filterState2.state_,dif);
+  ASSERT_NEAR(dif.norm(),0.0,1e-10);
+  ASSERT_NEAR((filterState1.cov_-filterState2.cov_).norm(),0.0,1e-10);
+
+  // Rejected outlier blocks do not count for the escalation
+  const int dI = TestFixture::mtUpdateExample::mtInnovation::D_;
+  this->testUpdate_.outlierDetection_.setEnabledAll(true);
+  this->testUpdate_.outlierDetection_.getMahalTh(0) = -1.0;
+  filterState2.cov_.setIdentity();
+  filterState2.state_ = this->testState_;
+  const unsigned int outlierCount = this->testUpdate_.outlierDetection_.getCount(0);
+  this->testUpdate_.performUpdate(filterState2,this->testUpdateMeas_);
+  ASSERT_EQ(this->testUpdate_.outlierDetection_.getCount(0),outlierCount+1);
+  const Eigen::VectorXd innInlier = this->testUpdate_.innVector_.tail(dI-3);
+  ASSERT_NEAR(this->testUpdate_.adaptiveMahalanobisDistance_,innInlier.dot(this->testUpdate_.Py_.bottomRightCorner(dI-3,dI-3).llt().solve(innInlier)),1e-10);
+
+  // The compacted update reuses the inverse of the escalation check
+  typename TestFixture::mtUpdateExample::mtFilterState filterState3;
+  filterState1.cov_.setIdentity();
+  filterState1.state_ = this->testState_;
+  filterState3 = filterState1;
+  this->testUpdate_.useOutlierCompaction_ = true;
+  this->testUpdate_.performUpdate(filterState1,this->testUpdateMeas_);
+  this->testUpdate_.useAdaptiveMode_ = false;
+  this->testUpdate_.performUpdate(filterState3,this->testUpdateMeas_);
+  filterState1.state_.boxMinus(filterState2.state_,dif);
+  ASSERT_NEAR(dif.norm(),0.0,1e-10);
+  ASSERT_NEAR((filterState1.cov_-filterState2.cov_).norm(),0.0,1e-10);
+  filterState3.state_.boxMinus(filterState2.state_,dif);
+  ASSERT_NEAR(dif.norm(),0.0,1e-10);
+  ASSERT_NEAR((filterState3.cov_-filterState2.cov_).norm(),0.0,1e-10);
+  this->testUpdate_.useOutlierCompaction_ = false;
+  this->testUpdate_.useAdaptiveMode_ = true;
+
+  // Coupled updates follow the mode of the prediction
+  this->testPredictAndUpdate_.useIndividualMode_ = true;
+  this->testPredictAndUpdate_.mode_ = LWF::ModeUKF;
+  filterState2.predictionMode_ = LWF::ModeEKF;
+  ASSERT_TRUE(this->testPredictAndUpdate_.getMode(filterState2) == LWF::ModeEKF);
+  filterState2.predictionMode_ = LWF::ModeIEKF;
+  ASSERT_TRUE(this->testPredictAndUpdate_.getMode(filterState2) == LWF::ModeIEKF);
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();